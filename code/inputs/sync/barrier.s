@@ -0,0 +1,70 @@
+.text
+    # Fork, then barrier. Core 0 starts CPU 1 and works for a while before
+    # starting CPUs 2 and 3, so CPU 1 reaches the barrier first. Each core
+    # works in proportion to its thread ID, writes its flag (thread ID + 1),
+    # waits at a barrier across all running cores, then prints the sum of
+    # the flags: 0xa on every core with 4 cores (1 with one core). Exactly
+    # one barrier is reported.
+
+    addiu $s0, $0, 0     # thread ID
+
+    addiu $v1, $0, 0
+    addiu $v0, $0, 1     # fork to CPU 1
+    syscall
+    bne $v1, $0, cpu1
+
+    addiu $t0, $0, 500   # core 0 keeps working before the other forks
+delay:
+    addiu $t0, $t0, -1
+    bne $t0, $0, delay
+
+    addiu $v1, $0, 0
+    addiu $v0, $0, 2
+    syscall
+    bne $v1, $0, cpu2
+    addiu $v1, $0, 0
+    addiu $v0, $0, 3
+    syscall
+    bne $v1, $0, cpu3
+    j start
+
+cpu1:
+    addiu $s0, $0, 1
+    j start
+cpu2:
+    addiu $s0, $0, 2
+    j start
+cpu3:
+    addiu $s0, $0, 3
+
+start:
+    # forked CPUs start with only $v1 set: set up addresses here
+    lui $a0, 0x1000      # 0x10000000: flags[0..3], one cache block each
+    sll $t0, $s0, 8      # 256 iterations of work per thread ID before the flag
+    beq $t0, $0, flag
+work:
+    addiu $t0, $t0, -1
+    bne $t0, $0, work
+flag:
+    sll $t0, $s0, 5
+    addu $t0, $a0, $t0
+    addiu $t1, $s0, 1
+    sw $t1, 0($t0)
+
+    addiu $v0, $0, 0x50  # barrier across all running cores
+    addiu $v1, $0, 0
+    syscall
+
+    lw $t2, 0($a0)
+    lw $t3, 0x20($a0)
+    addu $t2, $t2, $t3
+    lw $t3, 0x40($a0)
+    addu $t2, $t2, $t3
+    lw $t3, 0x60($a0)
+    addu $t2, $t2, $t3
+    addiu $v0, $0, 11
+    addu $v1, $t2, $0
+    syscall
+
+    addiu $v0, $0, 10
+    syscall
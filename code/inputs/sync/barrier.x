@@ -0,0 +1,46 @@
+24100000
+24030000
+24020001
+0000000c
+1460000c
+240801f4
+2508ffff
+1500fffe
+24030000
+24020002
+0000000c
+14600007
+24030000
+24020003
+0000000c
+14600005
+08100016
+24100001
+08100016
+24100002
+08100016
+24100003
+3c041000
+00104200
+11000002
+2508ffff
+1500fffe
+00104140
+00884021
+26090001
+ad090000
+24020050
+24030000
+0000000c
+8c8a0000
+8c8b0020
+014b5021
+8c8b0040
+014b5021
+8c8b0060
+014b5021
+2402000b
+01401821
+0000000c
+2402000a
+0000000c
@@ -0,0 +1,81 @@
+.text
+    # Every core adds 100 to a shared counter with LL/SC. Core 0 waits
+    # until the forked cores report done, then prints the counter:
+    # 0x64 per running core (0x190 with 4 cores).
+
+    addiu $s0, $0, 0     # thread ID
+    addiu $s1, $0, 0     # forks that succeeded
+
+    addiu $v1, $0, 2     # stays 2 if there is no such CPU
+    addiu $v0, $0, 1     # fork to CPU 1
+    syscall
+    beq $v1, $0, fork1
+    addiu $t0, $0, 1
+    beq $v1, $t0, cpu1
+    j fork2
+fork1:
+    addiu $s1, $s1, 1
+fork2:
+    addiu $v1, $0, 2
+    addiu $v0, $0, 2
+    syscall
+    beq $v1, $0, fork2ok
+    addiu $t0, $0, 1
+    beq $v1, $t0, cpu2
+    j fork3
+fork2ok:
+    addiu $s1, $s1, 1
+fork3:
+    addiu $v1, $0, 2
+    addiu $v0, $0, 3
+    syscall
+    beq $v1, $0, fork3ok
+    addiu $t0, $0, 1
+    beq $v1, $t0, cpu3
+    j start
+fork3ok:
+    addiu $s1, $s1, 1
+    j start
+
+cpu1:
+    addiu $s0, $0, 1
+    j start
+cpu2:
+    addiu $s0, $0, 2
+    j start
+cpu3:
+    addiu $s0, $0, 3
+
+start:
+    # forked CPUs start with only $v1 set: set up addresses here
+    lui $a0, 0x1000      # 0x10000000: counter
+    addiu $a1, $a0, 0x20 # 0x10000020: cores done (own cache block)
+    addiu $t0, $0, 100
+inc:
+    ll $t1, 0($a0)
+    addiu $t1, $t1, 1
+    sc $t1, 0($a0)
+    beq $t1, $0, inc     # link broken: retry
+    addiu $t0, $t0, -1
+    bne $t0, $0, inc
+
+    bne $s0, $0, report
+
+wait:
+    lw $t2, 0($a1)       # core 0: wait for the forked cores
+    bne $t2, $s1, wait
+    lw $t3, 0($a0)
+    addiu $v0, $0, 11
+    addu $v1, $t3, $0
+    syscall
+    j done
+
+report:
+    ll $t1, 0($a1)
+    addiu $t1, $t1, 1
+    sc $t1, 0($a1)
+    beq $t1, $0, report
+
+done:
+    addiu $v0, $0, 10
+    syscall
@@ -0,0 +1,55 @@
+24100000
+24110000
+24030002
+24020001
+0000000c
+10600003
+24080001
+10680013
+0810000a
+26310001
+24030002
+24020002
+0000000c
+10600003
+24080001
+1068000d
+08100012
+26310001
+24030002
+24020003
+0000000c
+10600003
+24080001
+10680007
+08100020
+26310001
+08100020
+24100001
+08100020
+24100002
+08100020
+24100003
+3c041000
+24850020
+24080064
+c0890000
+25290001
+e0890000
+1120fffc
+2508ffff
+1500fffa
+16000007
+8caa0000
+1551fffe
+8c8b0000
+2402000b
+01601821
+0000000c
+08100035
+c0a90000
+25290001
+e0a90000
+1120fffc
+2402000a
+0000000c
@@ -2,6 +2,8 @@
 #include "config.h"
 #include "core.h" // Needed for Core def
 #include "processor.h"
+#include "console.h"
+#include "observer.h"
 #include <cstring>
 #include <cmath>
 
@@ -10,12 +12,13 @@ extern uint32_t stat_cycles; // From shell.cpp
 
 /* Base Cache Methods */
 
-Cache::Cache(uint32_t s, uint32_t w, uint32_t b) 
-    : num_sets(s), ways(w), block_size(b), repl_policy((ReplacementPolicy)CACHE_REPL_POLICY) 
+Cache::Cache(uint32_t s, uint32_t w, uint32_t b, uint32_t sample_ratio) 
+    : num_sets(s), ways(w), block_size(b), repl_policy((ReplacementPolicy)CACHE_REPL_POLICY),
+      rng_state(0x9E3779B9u ^ (s * w))
 {
     sets.reserve(num_sets);
     for (uint32_t i = 0; i < num_sets; i++) {
-        sets.emplace_back(ways, block_size);
+        sets.emplace_back(sampled_set(i, sample_ratio) ? ways : 0, block_size);
     }
 
     /* Calculate bitwise fields assuming power of 2 */
@@ -27,10 +30,20 @@ Cache::Cache(uint32_t s, uint32_t w, uint32_t b)
     
     // tag_shift = index_shift + log2(num_sets)
     tag_shift = index_shift + (uint32_t)std::log2(num_sets);
+
+    energy.params = cache_energy_params(num_sets, ways, block_size);
+}
+
+bool Cache::sampled_set(uint32_t set_idx, uint32_t ratio) {
+    if (ratio <= 1) return true;
+    uint32_t h = set_idx * 0x9E3779B1u;
+    h ^= h >> 16;
+    return h % ratio == 0;
 }
 
 int Cache::find_block(uint32_t set_idx, uint32_t tag) const {
     const auto& set = sets[set_idx];
+    if (set.blocks.empty()) return -1; // Unsampled set
     for (int i = 0; i < ways; i++) {
         if (set.blocks[i].tag == tag && set.blocks[i].state != INVALID) {
             return i;
@@ -40,6 +53,7 @@ int Cache::find_block(uint32_t set_idx, uint32_t tag) const {
 }
 
 void Cache::update_lru(uint32_t set_idx, int way) {
+    if (repl_policy == REPL_FIFO) return; // Order is set at install only
     auto& set = sets[set_idx];
     uint32_t current_lru = set.blocks[way].lru_count;
     
@@ -61,7 +75,23 @@ int Cache::find_victim(uint32_t set_idx) const {
         if (set.blocks[i].state == INVALID) return i;
     }
 
-    // Else find LRU (highest count)
+    if (repl_policy == REPL_RANDOM) {
+        // xorshift32
+        rng_state ^= rng_state << 13;
+        rng_state ^= rng_state >> 17;
+        rng_state ^= rng_state << 5;
+        return rng_state % ways;
+    }
+
+    if (repl_policy == REPL_MRU) {
+        int victim = 0;
+        for (int i = 1; i < ways; i++) {
+            if (set.blocks[i].lru_count < set.blocks[victim].lru_count) victim = i;
+        }
+        return victim;
+    }
+
+    // Else find LRU (highest count); for FIFO the count is the install age
     int victim = -1;
     uint32_t max_lru = 0;
     
@@ -138,8 +168,9 @@ CacheBlock* Cache::install(uint32_t addr, const uint8_t* data, bool* dirty_evict
     
     // Check if block already exists (e.g. Upgrade from Shared)
     int way = find_block(set_idx, tag);
+    bool resident = (way != -1);
     
-    if (way != -1) {
+    if (resident) {
         // Found existing block, update it in place.
         // No eviction needed.
         if (dirty_evicted) *dirty_evicted = false;
@@ -155,22 +186,241 @@ CacheBlock* Cache::install(uint32_t addr, const uint8_t* data, bool* dirty_evict
     block.tag = tag;
     block.state = EXCLUSIVE; // Default for new block (or SHARED depending on coherence - fix later)
     block.dirty = false;
-    block.lru_count = 0; // MRU
+    if (!LRU_INSTALL_AGING) {
+        block.lru_count = 0; // MRU
+    } else if (!resident) {
+        block.lru_count = ways; // Past the LRU end: update_lru below ages every other line
+    }
     
     if (data) {
         std::memcpy(block.data.data(), data, block_size);
     }
     
     // Update LRU for others
+    if (repl_policy == REPL_FIFO) {
+        for (int i = 0; i < ways; i++) {
+            if (i != way && sets[set_idx].blocks[i].state != INVALID) sets[set_idx].blocks[i].lru_count++;
+        }
+    }
     update_lru(set_idx, way); 
     
     return &block;
 }
 
+/* Shadow Cache Methods */
+
+ShadowCache::ShadowCache(const ShadowConfig& c)
+    : Cache(c.sets, c.ways, BLOCK_SIZE), stat_accesses(0), stat_misses(0), stat_writebacks(0)
+{
+    repl_policy = c.repl;
+}
+
+const char* repl_policy_name(ReplacementPolicy p) {
+    switch (p) {
+        case REPL_RANDOM: return "RANDOM";
+        case REPL_FIFO: return "FIFO";
+        case REPL_MRU: return "MRU";
+        default: return "LRU";
+    }
+}
+
+void ShadowCache::access(uint32_t addr, bool is_write) {
+    stat_accesses++;
+    // Same hit handling as L2Cache::access: a write hit marks the line dirty
+    if (is_write ? probe_write(addr, nullptr) : probe_read(addr) != nullptr) return;
+
+    stat_misses++;
+    bool dirty_evicted = false;
+    install(addr, nullptr, &dirty_evicted, nullptr, nullptr);
+    if (dirty_evicted) stat_writebacks++;
+}
+
+void ShadowCache::writeback(uint32_t addr) {
+    // Write-no-allocate, as L2Cache::handle_l1_writeback for non-exclusive sets
+    if (!probe_write(addr, nullptr)) stat_writebacks++;
+}
+
 /* L2 Cache Methods */
 
-L2Cache::L2Cache(struct DRAM* dram) : Cache(L2_SETS, L2_ASSOC, BLOCK_SIZE), incl_policy((InclusionPolicy)L2_INCL_POLICY), dram_ref(dram) {
+L2Cache::L2Cache(struct DRAM* dram, uint32_t num_sets) : Cache(num_sets, L2_ASSOC, BLOCK_SIZE, L2_PRIVATE ? 1 : L2_SET_SAMPLING), incl_policy((InclusionPolicy)L2_INCL_POLICY), dram_ref(dram), clock(UNCORE_FREQ_MHZ), dbp(num_sets) {
     // Parent constructor handles initialization
+    energy.clock = &clock;
+    fill_core = -1;
+    warming = false;
+    flex_psel = ((1u << FLEX_PSEL_BITS) - 1) >> 1; // Neutral, inclusive
+    flex_mode = INCL_INCLUSIVE;
+    stat_flex_switches = 0;
+    migrated_dirty = false;
+    stat_back_invals = 0;
+    stat_eci_invals = 0;
+    stat_tlh_hints = 0;
+    stat_remote_hits = 0;
+    stat_mshr_merges = 0;
+    memset(stat_misses, 0, sizeof(stat_misses));
+    stat_qbs_skips = 0;
+    stat_writebacks = 0;
+    stat_demand_accesses = 0;
+    sampled_miss_rate = 1.0; // Cold
+    sampled_dirty_rate = 0.0;
+    stat_sampled_accesses = stat_sampled_misses = 0;
+    stat_estimated_accesses = stat_estimated_misses = 0;
+    estimate_rng = 0x2545F491u;
+    if (SHADOW_L2_ENABLE) {
+        const ShadowConfig configs[] = SHADOW_L2_CONFIGS;
+        for (const ShadowConfig& c : configs) shadows.emplace_back(c);
+    }
+    memset(stat_interference, 0, sizeof(stat_interference));
+    memset(pollution_filter, -1, sizeof(pollution_filter));
+}
+
+double L2Cache::estimate_draw() {
+    // xorshift32
+    estimate_rng ^= estimate_rng << 13;
+    estimate_rng ^= estimate_rng >> 17;
+    estimate_rng ^= estimate_rng << 5;
+    return estimate_rng / 4294967296.0;
+}
+
+uint32_t L2Cache::pollution_index(uint32_t addr) const {
+    return (addr >> index_shift) % FST_POLLUTION_FILTER_SIZE;
+}
+
+InclusionPolicy L2Cache::policy_for_set(uint32_t set_idx) const {
+    if (incl_policy != INCL_FLEX) return incl_policy;
+    switch (set_idx % FLEX_LEADER_STRIDE) {
+        case 0: return INCL_INCLUSIVE; // Inclusive leader
+        case 1: return INCL_EXCLUSIVE; // Exclusive leader
+        default: return flex_mode;
+    }
+}
+
+void L2Cache::flex_record(uint32_t set_idx, uint32_t cost) {
+    if (incl_policy != INCL_FLEX) return;
+    const uint32_t psel_max = (1u << FLEX_PSEL_BITS) - 1;
+    uint32_t leader = set_idx % FLEX_LEADER_STRIDE;
+    if (leader == 0) {
+        flex_psel = (flex_psel + cost > psel_max) ? psel_max : flex_psel + cost;
+    } else if (leader == 1) {
+        flex_psel = (flex_psel < cost) ? 0 : flex_psel - cost;
+    } else {
+        return;
+    }
+
+    // Followers switch without flushing: stale duplicates or L1-only lines
+    // are tolerated since coherence snoops every L1 directly
+    InclusionPolicy mode = (flex_psel > (psel_max >> 1)) ? INCL_EXCLUSIVE : INCL_INCLUSIVE;
+    if (mode != flex_mode) {
+        flex_mode = mode;
+        stat_flex_switches++;
+#ifdef DEBUG
+        console.print(CONSOLE_SYSTEM, "[L2] FLEXclusion: followers now %s (PSEL %u)\n", mode == INCL_EXCLUSIVE ? "exclusive" : "inclusive", flex_psel);
+#endif
+    }
+}
+
+bool L2Cache::probe_coherence(uint32_t addr, bool is_write_req, bool* is_modified, int requester) {
+    energy.charge_snoop();
+    uint32_t set_idx = get_index(addr);
+    int way = find_block(set_idx, get_tag(addr));
+
+    // Inclusive: a line absent here is absent from our L1s too. Not under
+    // INCL_FLEX, where a set switching from exclusive leaves L1-only lines
+    if (way == -1 && incl_policy == INCL_INCLUSIVE) return false;
+
+    bool present = false;
+    bool modified = false;
+    for (auto* l1 : l1_refs) {
+        bool m = false;
+        std::vector<uint8_t> data;
+        if (l1->probe_coherence(addr, is_write_req, &m, &data, requester)) {
+            present = true;
+            if (m) modified = true;
+        }
+    }
+
+    if (way != -1) {
+        CacheBlock& blk = sets[set_idx].blocks[way];
+        present = true;
+        if (blk.dirty || blk.state == MODIFIED) modified = true;
+        energy.charge_read(); // Supplies the line
+
+        // Dirty data is written to memory by the requester
+        blk.state = is_write_req ? INVALID : SHARED;
+        blk.dirty = false;
+    }
+
+    if (is_modified) *is_modified = modified;
+    return present;
+}
+
+MESI_State L2Cache::state_of(uint32_t addr) const {
+    uint32_t set_idx = get_index(addr);
+    int way = find_block(set_idx, get_tag(addr));
+    return (way == -1) ? INVALID : sets[set_idx].blocks[way].state;
+}
+
+void L2Cache::install_coherent(uint32_t addr, MESI_State state) {
+    uint32_t set_idx = get_index(addr);
+    int way = find_block(set_idx, get_tag(addr));
+    if (way != -1) {
+        // Upgrade in place
+        sets[set_idx].blocks[way].state = state;
+        update_lru(set_idx, way);
+        return;
+    }
+
+    bool dirty_evicted = false;
+    uint32_t evicted_addr;
+    std::vector<uint8_t> evicted_data;
+    CacheBlock* blk = install(addr, nullptr, &dirty_evicted, &evicted_addr, &evicted_data);
+    blk->state = state;
+    blk->dead = false;
+    energy.charge_write();
+
+    if (dirty_evicted && dram_ref) {
+        energy.charge_read();
+        stat_writebacks++;
+        dram_ref->enqueue(true, evicted_addr, -1, DRAM_Req::SRC_MEMORY, stat_cycles);
+    }
+}
+
+void L2Cache::hint(uint32_t addr) {
+    if (policy_for(addr) != INCL_INCLUSIVE) return;
+    stat_tlh_hints++;
+    energy.charge_tag();
+    uint32_t set_idx = get_index(addr);
+    int way = find_block(set_idx, get_tag(addr));
+    if (way != -1) update_lru(set_idx, way);
+}
+
+bool L2Cache::in_l1(uint32_t addr) const {
+    for (auto* l1 : l1_refs) {
+        if (l1->find_block(l1->get_index(addr), l1->get_tag(addr)) != -1) return true;
+    }
+    return false;
+}
+
+void L2Cache::early_invalidate(uint32_t set_idx) {
+    int way = find_victim(set_idx);
+    CacheBlock& blk = sets[set_idx].blocks[way];
+    if (blk.state == INVALID) return;
+
+    // The line stays in L2: an L1 re-reference hits there and refreshes its LRU position
+    uint32_t victim_addr = (blk.tag << tag_shift) | (set_idx << index_shift);
+    for (auto* l1 : l1_refs) {
+        bool is_modified = false;
+        std::vector<uint8_t> data;
+        if (l1->probe_coherence(victim_addr, true, &is_modified, &data)) {
+            stat_eci_invals++;
+            l1->note_inclusion_victim(victim_addr, true);
+            if (is_modified) {
+                // Absorb the dirty data without touching LRU
+                blk.data = data;
+                blk.dirty = true;
+                energy.charge_write();
+            }
+        }
+    }
 }
 
 int L2Cache::check_mshr(uint32_t addr) {
@@ -183,7 +433,7 @@ int L2Cache::check_mshr(uint32_t addr) {
     return -1;
 }
 
-int L2Cache::allocate_mshr(uint32_t addr, bool is_write, int core_id) {
+int L2Cache::allocate_mshr(uint32_t addr, bool is_write, int core_id, uint32_t pc) {
     uint32_t block_addr = addr & ~(block_size - 1);
     for (int i = 0; i < L2_MSHR_SIZE; i++) {
         if (!mshrs[i].valid) {
@@ -191,15 +441,33 @@ int L2Cache::allocate_mshr(uint32_t addr, bool is_write, int core_id) {
             mshrs[i].address = block_addr;
             mshrs[i].is_write = is_write;
             mshrs[i].core_id = core_id; // Store requester
+            mshrs[i].pc = pc;
+            mshrs[i].targets[0] = {core_id, false, is_write}; // Primary: both L1s are woken
+            mshrs[i].num_targets = 1;
             mshrs[i].done = false;
             mshrs[i].ready_cycle = 0;
+            OBSERVE(on_l2_mshr_alloc, core_id, block_addr, is_write);
             return i;
         }
     }
     return -1; // Full
 }
 
-int L2Cache::access(uint32_t addr, bool is_write, int core_id) {
+bool L2Cache::add_target(int mshr_idx, int core_id, bool is_icache) {
+    MSHR& m = mshrs[mshr_idx];
+    if (m.num_targets >= L2_MSHR_TARGETS) return false;
+
+    // Reads only: every target then shares the line
+    for (int t = 0; t < m.num_targets; t++) {
+        if (m.targets[t].is_write) return false;
+    }
+
+    m.targets[m.num_targets++] = {core_id, is_icache, false};
+    stat_mshr_merges++;
+    return true;
+}
+
+int L2Cache::access(uint32_t addr, bool is_write, int core_id, uint32_t pc) {
     // 1. Spec: "A free MSHR is a prerequisite for an access to the L2 cache"
     // Check if we can allocate OR if it's already pending (merge).
     // If not merged and valid MSHRs full, we must stall.
@@ -215,19 +483,61 @@ int L2Cache::access(uint32_t addr, bool is_write, int core_id) {
         }
         if (!free_slot) return L2_BUSY;
     }
+    stat_demand_accesses++;
+
+    if (SHADOW_L2_ENABLE) {
+        for (auto& shadow : shadows) shadow.access(addr, is_write);
+    }
+    if (RD_PROFILE && !l1_refs.empty()) l1_refs[0]->parent_core->proc->reuse.access_l2(core_id, addr);
+
+    migrated_dirty = false;
+
+    // Set sampling: an unsampled set holds no tags, so draw hit or miss from
+    // the sampled sets' miss rate. A miss then takes the normal miss path.
+    bool modelled_set = modelled(get_index(addr));
+    if (!modelled_set) {
+        stat_estimated_accesses++;
+        if (pending_idx == -1 && estimate_draw() >= sampled_miss_rate) {
+            energy.charge_tag();
+            if (is_write) energy.charge_write();
+            else energy.charge_read();
+            return L2_HIT;
+        }
+        stat_estimated_misses++;
+    } else if (L2_SET_SAMPLING > 1) {
+        bool miss = find_block(get_index(addr), get_tag(addr)) == -1;
+        stat_sampled_accesses++;
+        stat_sampled_misses += miss;
+        sampled_miss_rate += ((miss ? 1.0 : 0.0) - sampled_miss_rate) / L2_SAMPLING_WINDOW;
+    }
+
+    // Dead-block prediction: train the sampler, re-predict a resident block
+    if (DBP_ENABLE && modelled_set) {
+        uint32_t set_idx = get_index(addr);
+        int way = find_block(set_idx, get_tag(addr));
+        if (way != -1) {
+            CacheBlock& blk = sets[set_idx].blocks[way];
+            if (blk.dead) dbp.stat_false_dead++;
+            blk.dead = dbp.predict(pc);
+        }
+        dbp.access(set_idx, get_tag(addr), pc);
+    }
 
     // 2. Check Cache Hit
+    energy.charge_tag();
     if (is_write) {
         if (probe_write(addr, nullptr)) {
+            energy.charge_write();
             // In INCLUSIVE policy: L2 Hit is normal.
             
             // In EXCLUSIVE policy: L2 Hit means block is moving to L1.
             // We must invalidate the L2 copy.
-            if (incl_policy == INCL_EXCLUSIVE) {
+            if (policy_for(addr) == INCL_EXCLUSIVE) {
                 uint32_t set_idx = get_index(addr);
                 uint32_t tag = get_tag(addr);
                 int way = find_block(set_idx, tag);
                 if (way != -1) {
+                   migrated_dirty = sets[set_idx].blocks[way].dirty;
                    sets[set_idx].blocks[way].state = INVALID;
                    sets[set_idx].blocks[way].dirty = false;
                 }
@@ -236,13 +546,15 @@ int L2Cache::access(uint32_t addr, bool is_write, int core_id) {
         }
     } else {
         if (probe_read(addr) != nullptr) {
+            energy.charge_read();
             // EXCLUSIVE Policy: On L2 Hit, invalidate block (move to L1)
             // Note: probe_read updated LRU. Invalidate effectively removes it.
-            if (incl_policy == INCL_EXCLUSIVE) {
+            if (policy_for(addr) == INCL_EXCLUSIVE) {
                 uint32_t set_idx = get_index(addr);
                 uint32_t tag = get_tag(addr);
                 int way = find_block(set_idx, tag);
                 if (way != -1) {
+                   migrated_dirty = sets[set_idx].blocks[way].dirty;
                    sets[set_idx].blocks[way].state = INVALID;
                    sets[set_idx].blocks[way].dirty = false;
                 }
@@ -258,14 +570,26 @@ int L2Cache::access(uint32_t addr, bool is_write, int core_id) {
 
     // 4. New Miss: Allocate MSHR
     // We already checked for a free slot above.
-    int mshr_idx = allocate_mshr(addr, is_write, core_id); 
+    int mshr_idx = allocate_mshr(addr, is_write, core_id, pc); 
     if (mshr_idx != -1) {
+        flex_record(get_index(addr), FLEX_MISS_COST);
+        if (core_id >= 0 && core_id < NUM_CORES) stat_misses[core_id]++;
+
+        // Contention miss: another core's fill evicted this line
+        if (core_id >= 0 && core_id < NUM_CORES) {
+            int8_t& evictor = pollution_filter[core_id][pollution_index(addr)];
+            if (evictor >= 0 && evictor < NUM_CORES && evictor != core_id) {
+                stat_interference[core_id][evictor] += FST_MISS_PENALTY;
+            }
+            evictor = -1;
+        }
+
         // Enqueue to Request Queue (5 cycle delay)
         Req_Queue_Item item;
         item.is_write = is_write;
         item.addr = addr;
         item.core_id = core_id;
-        item.ready_cycle = stat_cycles + L2_TO_DRAM_DELAY;
+        item.ready_cycle = clock.cycles + L2_TO_DRAM_DELAY + clock.crossing(dram_ref->clock);
         req_queue.push_back(item);
         
         return L2_MISS; 
@@ -279,7 +603,7 @@ void L2Cache::handle_dram_completion(uint32_t addr) {
     // DRAM returned data. Enqueue to Return Queue (5 cycle delay).
     Ret_Queue_Item item;
     item.addr = addr;
-    item.ready_cycle = stat_cycles + DRAM_TO_L2_DELAY;
+    item.ready_cycle = clock.cycles + DRAM_TO_L2_DELAY + clock.crossing(dram_ref->clock);
     ret_queue.push_back(item);
 }
 
@@ -289,7 +613,7 @@ void L2Cache::cycle(uint64_t current_cycle, std::vector<std::unique_ptr<Core>>&
         if (current_cycle >= it->ready_cycle) {
             // Send to DRAM
             if (dram_ref) {
-                dram_ref->enqueue(it->is_write, it->addr, it->core_id, DRAM_Req::SRC_MEMORY, current_cycle);
+                dram_ref->enqueue(it->is_write, it->addr, it->core_id, DRAM_Req::SRC_MEMORY, stat_cycles);
             }
             it = req_queue.erase(it);
         } else {
@@ -314,18 +638,47 @@ void L2Cache::complete_mshr(uint32_t addr, std::vector<std::unique_ptr<class Cor
     for (int i = 0; i < L2_MSHR_SIZE; i++) {
         if (mshrs[i].valid && mshrs[i].address == block_addr) {
             mshrs[i].valid = false;
+            OBSERVE(on_l2_mshr_complete, mshrs[i].core_id, block_addr);
+            FillTrace fill_trace;
+            if (MISS_LATENCY_PROFILE && !cores.empty()) fill_trace = cores[0]->proc->latency.take(block_addr);
             
             // Install in L2
-            bool dirty_evicted;
+            bool dirty_evicted = false;
             uint32_t evicted_addr;
             std::vector<uint8_t> evicted_data;
             
-            install(addr, nullptr, &dirty_evicted, &evicted_addr, &evicted_data);
+            // Dead on arrival: bypass L2 allocation. Inclusion requires the
+            // L2 copy, so only non-inclusive policies may bypass.
+            bool dead = DBP_ENABLE && dbp.predict(mshrs[i].pc);
+            if (!modelled(get_index(addr))) {
+                // Unsampled set: evict a dirty line as often as the sampled sets do
+                dirty_evicted = estimate_draw() < sampled_dirty_rate;
+                evicted_addr = block_addr ^ (1u << tag_shift); // Invented victim in the same set (see L2_SET_SAMPLING)
+            } else if (dead && DBP_BYPASS && policy_for(addr) != INCL_INCLUSIVE) {
+                dbp.stat_bypasses++;
+            } else {
+                fill_core = mshrs[i].core_id;
+                CacheBlock* blk = install(addr, nullptr, &dirty_evicted, &evicted_addr, &evicted_data);
+                blk->owner = mshrs[i].core_id;
+                blk->dead = dead;
+                if (L2_PRIVATE) blk->state = mshrs[i].is_write ? MODIFIED : EXCLUSIVE;
+                fill_core = -1;
+                energy.charge_write();
+                if (L2_SET_SAMPLING > 1) {
+                    sampled_dirty_rate += ((dirty_evicted ? 1.0 : 0.0) - sampled_dirty_rate) / L2_SAMPLING_WINDOW;
+                }
+
+                if (TLA_POLICY == TLA_ECI && policy_for(addr) == INCL_INCLUSIVE) {
+                    early_invalidate(get_index(addr));
+                }
+            }
             
             // Handle L2 Writeback to DRAM
             if (dirty_evicted && dram_ref) {
+                 energy.charge_read();
                  // Use stat_cycles. Spec: "Immediately written into main memory"
                  // Note: L2 eviction goes to SRC_MEMORY.
+                 stat_writebacks++;
                  dram_ref->enqueue(true, evicted_addr, -1, DRAM_Req::SRC_MEMORY, stat_cycles);
             }
             
@@ -338,34 +691,176 @@ void L2Cache::complete_mshr(uint32_t addr, std::vector<std::unique_ptr<class Cor
                 // If read, we grant EXCLUSIVE (assuming we are the only one, or SHARED if others have it - but that logic belongs in Coherence step). 
                 // However, L2 Fill usually means we fetched from DRAM, so it's fresh.
                 MESI_State st = mshrs[i].is_write ? MODIFIED : EXCLUSIVE;
+                // Merged readers all receive the line SHARED
+                if (mshrs[i].num_targets > 1) st = SHARED;
                 
-                cores[cid]->icache.fill(addr, st);
-                cores[cid]->dcache.fill(addr, st);
+                cores[cid]->icache.respond(addr, st, &fill_trace);
+                cores[cid]->dcache.respond(addr, st, &fill_trace);
+            }
+
+            // Secondary targets
+            for (int t = 1; t < mshrs[i].num_targets; t++) {
+                const MSHR_Target& tgt = mshrs[i].targets[t];
+                if (tgt.core_id < 0 || tgt.core_id >= (int)cores.size()) continue;
+                L1Cache& l1 = tgt.is_icache ? cores[tgt.core_id]->icache : cores[tgt.core_id]->dcache;
+                l1.respond(addr, SHARED, &fill_trace);
             }
         }
     }
 }
 
-void L2Cache::handle_l1_writeback(uint32_t addr, const std::vector<uint8_t>& data) {
+void L2Cache::handle_l1_writeback(uint32_t addr, const std::vector<uint8_t>& data, bool dirty) {
+    if (SHADOW_L2_ENABLE && dirty) {
+        for (auto& shadow : shadows) shadow.writeback(addr);
+    }
+    // Unsampled set: taken as an L2 hit; its DRAM traffic is in the estimated evictions
+    if (!modelled(get_index(addr))) return;
+
     // Probe L2 for Write
-    if (probe_write(addr, data.data())) {
-        // Hit: L2 updated (dirty bit set, LRU updated, data copied)
+    energy.charge_tag();
+    if (dirty) {
+        if (probe_write(addr, data.data())) {
+            energy.charge_write();
+            // Hit: L2 updated (dirty bit set, LRU updated, data copied)
+            return;
+        }
+    } else if (find_block(get_index(addr), get_tag(addr)) != -1) {
+        return; // Clean victim already present
+    }
+
+    // Exclusive: the L2 holds the lines the L1s evict
+    if (policy_for(addr) == INCL_EXCLUSIVE) {
+        if (!dirty) flex_record(get_index(addr), FLEX_TRAFFIC_COST);
+
+        bool dirty_evicted = false;
+        uint32_t evicted_addr;
+        std::vector<uint8_t> evicted_data;
+        CacheBlock* blk = install(addr, data.data(), &dirty_evicted, &evicted_addr, &evicted_data);
+        blk->dirty = dirty;
+        blk->owner = -1;
+        blk->dead = false;
+        energy.charge_write();
+
+        if (dirty_evicted && dram_ref) {
+            energy.charge_read();
+            stat_writebacks++;
+            dram_ref->enqueue(true, evicted_addr, -1, DRAM_Req::SRC_MEMORY, stat_cycles);
+        }
         return;
     }
+
+    // Clean data needs no writeback
+    if (!dirty) return;
     
     // Miss: Write directly to DRAM (Bypass L2 allocation)
     if (dram_ref) {
+        stat_writebacks++;
         dram_ref->enqueue(true, addr, -1, DRAM_Req::SRC_MEMORY, stat_cycles);
     }
 }
 
 
+void L2Cache::warm(uint32_t addr, MESI_State state) {
+    uint32_t set_idx = get_index(addr);
+    if (!modelled(set_idx)) return; // Unsampled set (L2_SET_SAMPLING)
+    int way = find_block(set_idx, get_tag(addr));
+    if (way != -1) {
+        CacheBlock& blk = sets[set_idx].blocks[way];
+        if (policy_for_set(set_idx) == INCL_EXCLUSIVE) {
+            // Moves to the L1
+            blk.state = INVALID;
+            blk.dirty = false;
+            return;
+        }
+        update_lru(set_idx, way);
+        if (L2_PRIVATE && state == MODIFIED) blk.state = MODIFIED;
+        return;
+    }
+    if (policy_for_set(set_idx) == INCL_EXCLUSIVE) return;
+
+    bool dirty_evicted = false;
+    uint32_t evicted_addr;
+    std::vector<uint8_t> evicted_data;
+    warming = true;
+    CacheBlock* blk = install(addr, nullptr, &dirty_evicted, &evicted_addr, &evicted_data);
+    warming = false;
+    blk->owner = -1;
+    blk->dead = false;
+    if (L2_PRIVATE) blk->state = (state == MODIFIED) ? MODIFIED : EXCLUSIVE;
+}
+
+void L2Cache::warm_writeback(uint32_t addr, bool dirty) {
+    uint32_t set_idx = get_index(addr);
+    if (!modelled(set_idx)) return; // Unsampled set (L2_SET_SAMPLING)
+    int way = find_block(set_idx, get_tag(addr));
+    if (way != -1) {
+        if (dirty) sets[set_idx].blocks[way].dirty = true;
+        return;
+    }
+    if (policy_for_set(set_idx) != INCL_EXCLUSIVE) return;
+
+    bool dirty_evicted = false;
+    uint32_t evicted_addr;
+    std::vector<uint8_t> evicted_data;
+    warming = true;
+    CacheBlock* blk = install(addr, nullptr, &dirty_evicted, &evicted_addr, &evicted_data);
+    warming = false;
+    blk->dirty = dirty;
+    blk->owner = -1;
+    blk->dead = false;
+}
+
+int L2Cache::find_victim(uint32_t set_idx) const {
+    bool qbs = (TLA_POLICY == TLA_QBS && policy_for_set(set_idx) == INCL_INCLUSIVE);
+    if (!DBP_ENABLE && !qbs) return Cache::find_victim(set_idx);
+
+    const auto& set = sets[set_idx];
+    for (int i = 0; i < ways; i++) {
+        if (set.blocks[i].state == INVALID) return i;
+    }
+
+    // Least recently used of the predicted-dead blocks
+    if (DBP_ENABLE) {
+        int victim = -1;
+        for (int i = 0; i < ways; i++) {
+            if (set.blocks[i].dead && (victim == -1 || set.blocks[i].lru_count > set.blocks[victim].lru_count)) {
+                victim = i;
+            }
+        }
+        if (victim != -1) return victim;
+    }
+
+    // QBS: query candidates in LRU order, skipping lines held by an L1
+    if (qbs) {
+        std::vector<bool> queried(ways, false); // Ways already skipped (lru_counts may tie)
+        for (int q = 0; q < TLA_QBS_MAX_QUERIES; q++) {
+            int cand = -1;
+            for (int i = 0; i < ways; i++) {
+                if (!queried[i] && (cand == -1 || set.blocks[i].lru_count > set.blocks[cand].lru_count)) cand = i;
+            }
+            if (cand == -1) break;
+            uint32_t cand_addr = (set.blocks[cand].tag << tag_shift) | (set_idx << index_shift);
+            if (!in_l1(cand_addr)) return cand;
+            stat_qbs_skips++;
+            queried[cand] = true;
+        }
+    }
+    return Cache::find_victim(set_idx);
+}
+
 // Helper to get back pointers
 void L2Cache::evict(uint32_t set_idx, int way, bool* dirty_evicted, uint32_t* evicted_addr, std::vector<uint8_t>* evicted_data, bool writeback_clean) {
     // 1. Get address of victim block
     uint32_t old_tag = sets[set_idx].blocks[way].tag;
     uint32_t old_addr = (old_tag << tag_shift) | (set_idx << index_shift);
     bool is_valid = sets[set_idx].blocks[way].state != INVALID;
+    int owner = sets[set_idx].blocks[way].owner;
+    if (DBP_ENABLE && is_valid && sets[set_idx].blocks[way].dead) dbp.stat_dead_victims++;
+
+    // Remember lines evicted by another core's fill (FST interference)
+    if (is_valid && owner >= 0 && owner < NUM_CORES && fill_core >= 0 && fill_core != owner) {
+        pollution_filter[owner][pollution_index(old_addr)] = fill_core;
+    }
 
     // 2. Call base eviction (handles data extraction and invalidation)
     Cache::evict(set_idx, way, dirty_evicted, evicted_addr, evicted_data, writeback_clean);
@@ -373,7 +868,7 @@ void L2Cache::evict(uint32_t set_idx, int way, bool* dirty_evicted, uint32_t* ev
     // 3. Inclusive Policy: Invalidate in all L1s logic
     // If the policy is Inclusive, an eviction from L2 forces invalidation in all L1s (Back-invalidation).
     // If any L1 has a dirty copy, it must be written back to Memory to preserve data consistency.
-    if (incl_policy == INCL_INCLUSIVE && is_valid) {
+    if (policy_for_set(set_idx) == INCL_INCLUSIVE && is_valid) {
         for (auto* l1 : l1_refs) {
             // First check if L1 has it and if it's dirty
             bool is_modified = false;
@@ -383,11 +878,16 @@ void L2Cache::evict(uint32_t set_idx, int way, bool* dirty_evicted, uint32_t* ev
             // Let's use probe_coherence (which we implemented).
             bool present = l1->probe_coherence(old_addr, true, &is_modified, &data); 
             // true arg means "is_write_req" -> will invalidate L1 block. Perfect.
+            if (present) {
+                stat_back_invals++;
+                l1->note_inclusion_victim(old_addr, false);
+            }
             
             if (present && is_modified) {
                 // We back-invalidated a dirty block from L1. 
                 // Since L2 is evicting, we must write this data to Memory.
-                if (dram_ref) {
+                if (dram_ref && !warming) {
+                     stat_writebacks++;
                      dram_ref->enqueue(true, old_addr, -1, DRAM_Req::SRC_MEMORY, stat_cycles);
                 }
             }
@@ -403,6 +903,8 @@ bool L1Cache::invalidate(uint32_t addr) {
     int way = find_block(set_idx, tag);
     
     if (way != -1) {
+        MESI_State from = sets[set_idx].blocks[way].state;
+        if (from != INVALID) OBSERVE(on_coherence, id, is_icache(), addr & ~(block_size - 1), from, INVALID);
         sets[set_idx].blocks[way].state = INVALID;
         sets[set_idx].blocks[way].dirty = false;
         return true;
@@ -414,7 +916,8 @@ bool L1Cache::invalidate(uint32_t addr) {
 // (No change)
 
 L1Cache::L1Cache(int core_id, L2Cache* l2, class Core* core, uint32_t s, uint32_t w) 
-    : Cache(s, w, BLOCK_SIZE), id(core_id), l2_ref(l2), parent_core(core)
+    : Cache(s, w, BLOCK_SIZE), id(core_id), l2_ref(l2), parent_core(core),
+      inclusion_filter(TLA_FILTER_SIZE, 0), stat_harmful_back_invals(0), stat_eci_rereferences(0), stat_misses(0), stat_hits(0)
 {
     // Initialize MSHR
     mshr.valid = false;
@@ -429,7 +932,64 @@ L1Cache::L1Cache(int core_id, L2Cache* l2, class Core* core, uint32_t s, uint32_
 }
 
 
-bool L1Cache::probe_coherence(uint32_t addr, bool is_write_req, bool* is_modified, std::vector<uint8_t>* data) {
+void L1Cache::note_inclusion_victim(uint32_t addr, bool early) {
+    uint32_t block_addr = addr & ~(block_size - 1);
+    inclusion_filter[(block_addr >> index_shift) % TLA_FILTER_SIZE] = block_addr | (early ? 1 : 0);
+}
+
+void L1Cache::drop_displaced_link() {
+    Core* core = parent_core;
+    if (core->ll_valid && this == &core->dcache &&
+        find_block(get_index(core->ll_addr), get_tag(core->ll_addr)) == -1) {
+        core->ll_valid = false;
+    }
+}
+
+void L1Cache::warm(uint32_t addr, bool is_write) {
+    uint32_t set_idx = get_index(addr);
+    int way = find_block(set_idx, get_tag(addr));
+    if (way != -1 && (!is_write || sets[set_idx].blocks[way].state != SHARED)) {
+        CacheBlock& blk = sets[set_idx].blocks[way];
+        update_lru(set_idx, way);
+        if (is_write) {
+            blk.state = MODIFIED;
+            blk.dirty = true;
+        }
+        return;
+    }
+
+    // Snoops a timing miss would perform
+    bool shared = false;
+    bool m = false;
+    if (L2_PRIVATE) {
+        for (auto* l2 : parent_core->proc->l2s) {
+            if (l2 != l2_ref && l2->probe_coherence(addr, is_write, &m)) shared = true;
+        }
+    } else {
+        for (const auto& core_ptr : parent_core->proc->cores) {
+            if (core_ptr->id == id) continue;
+            if (core_ptr->icache.probe_coherence(addr, is_write, &m, nullptr)) shared = true;
+            if (core_ptr->dcache.probe_coherence(addr, is_write, &m, nullptr)) shared = true;
+        }
+    }
+    MESI_State state = is_write ? MODIFIED : (shared ? SHARED : EXCLUSIVE);
+    l2_ref->warm(addr, state);
+
+    bool dirty_evicted = false;
+    uint32_t evicted_addr;
+    std::vector<uint8_t> evicted_data;
+    bool wb_clean = (l2_ref->incl_policy == INCL_EXCLUSIVE || l2_ref->incl_policy == INCL_FLEX);
+    CacheBlock* blk = install(addr, nullptr, &dirty_evicted, &evicted_addr, &evicted_data, wb_clean);
+    blk->state = state;
+    blk->dirty = is_write;
+    if (dirty_evicted || (wb_clean && evicted_data.size() > 0)) {
+        l2_ref->warm_writeback(evicted_addr, dirty_evicted);
+    }
+    drop_displaced_link();
+}
+
+bool L1Cache::probe_coherence(uint32_t addr, bool is_write_req, bool* is_modified, std::vector<uint8_t>* data, int requester) {
+    energy.charge_snoop();
     uint32_t set_idx = get_index(addr);
     uint32_t tag = get_tag(addr);
     int way = find_block(set_idx, tag);
@@ -438,6 +998,7 @@ bool L1Cache::probe_coherence(uint32_t addr, bool is_write_req, bool* is_modifie
         CacheBlock& blk = sets[set_idx].blocks[way];
         if (blk.state == INVALID) return false;
 
+        MESI_State from = blk.state;
         bool was_modified = (blk.state == MODIFIED);
         if (is_modified) *is_modified = was_modified;
         
@@ -445,12 +1006,14 @@ bool L1Cache::probe_coherence(uint32_t addr, bool is_write_req, bool* is_modifie
         if (was_modified && data) {
             *data = blk.data;
         }
+        if (was_modified) energy.charge_read();
 
         // State Transitions based on Snoop
         if (is_write_req) {
-            // Another core is writing -> Invalidate our copy
+            // Another core is writing -> Invalidate our copy (and break an LL link on it)
             blk.state = INVALID;
             blk.dirty = false;
+            parent_core->clear_link(addr);
         } else {
             // Another core is reading -> Downgrade to Shared
             // If we were Modified or Exclusive, we become Shared.
@@ -462,24 +1025,37 @@ bool L1Cache::probe_coherence(uint32_t addr, bool is_write_req, bool* is_modifie
                 blk.dirty = false; 
             }
         }
+        if (blk.state != from) OBSERVE(on_coherence, id, is_icache(), addr & ~(block_size - 1), from, blk.state);
+        if (FALSE_SHARING_DETECT && requester >= 0 && blk.state != from) {
+            parent_core->proc->sharing.coherence(requester, id, addr, is_write_req);
+        }
         return true;
     }
     return false;
 }
 
-bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
+bool L1Cache::would_hit(uint32_t addr, bool is_write) const {
+    if (mshr.valid) return false;
+    uint32_t set_idx = get_index(addr);
+    int way = find_block(set_idx, get_tag(addr));
+    if (way == -1) return false;
+    MESI_State state = sets[set_idx].blocks[way].state;
+    return !is_write || state == MODIFIED || state == EXCLUSIVE;
+}
+
+bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache, uint32_t pc) {
     // 1. Check MSHR (Pending Miss)
     if (mshr.valid) {
         // If we are waiting for this address, check if it's ready
         uint32_t block_addr = addr & ~(block_size - 1);
         if (mshr.address == block_addr) {
-            if (stat_cycles >= mshr.ready_cycle) {
+            if (now() >= mshr.ready_cycle) {
                 // Determine target state from MSHR context (saved or inferred)
                 // For now, assume we fill nicely.
                 // Actually fill() is called by L2 response or Snoop response.
                 // If ready_cycle is set, it means we hit somewhere and are waiting for latency.
 #ifdef DEBUG
-                printf("[L1 Core %d] Access %08x: MSHR Ready at %lu (Curr %u). Completing.\n", id, addr, mshr.ready_cycle, stat_cycles);
+                console.print(id, "[L1 Core %d] Access %08x: MSHR Ready at %lu (Curr %lu). Completing.\n", id, addr, mshr.ready_cycle, now());
 #endif
                 // NOTE: If we satisfied the miss via Snoop or L2 Hit, the data isn't "pushed" to us via callback nicely in this framework without events.
                 // So we simulate the "fill" happening here if it wasn't triggered by L2 callback.
@@ -495,6 +1071,10 @@ bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
             } else {
                 return false; // Stall
             }
+        } else if (now() >= mshr.ready_cycle) {
+            // The pending block is ready but the requester moved on (e.g. fetch
+            // redirected by a branch). Complete it, then serve this access.
+            fill(mshr.address, (MESI_State)mshr.target_state);
         } else {
             return false; // Stall, MSHR busy
         }
@@ -515,7 +1095,13 @@ bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
             block = &sets[set_idx].blocks[way];
             if (block->state == MODIFIED || block->state == EXCLUSIVE) {
                 // Hit!
+                energy.charge_tag();
+                energy.charge_write();
                 update_lru(set_idx, way);
+                if (TLA_POLICY == TLA_TLH) l2_ref->hint(addr);
+                OBSERVE(on_l1_hit, id, is_icache(), addr, true);
+                stat_hits++;
+                if (block->state == EXCLUSIVE) OBSERVE(on_coherence, id, is_icache(), addr & ~(block_size - 1), EXCLUSIVE, MODIFIED);
                 block->state = MODIFIED;
                 block->dirty = true;
                 return true;
@@ -526,10 +1112,27 @@ bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
     } else {
         // Read
         block = probe_read(addr); // Handles LRU update if hit
-        if (block) return true;
+        if (block) {
+            energy.charge_tag();
+            energy.charge_read();
+            if (TLA_POLICY == TLA_TLH) l2_ref->hint(addr);
+            OBSERVE(on_l1_hit, id, is_icache(), addr, false);
+            stat_hits++;
+            return true;
+        }
     }
     
     // --- MISS HANDLING START ---
+
+    // A new miss, or a retry after a gap, starts the latency clock
+    if (MISS_LATENCY_PROFILE) {
+        uint32_t block_addr = addr & ~(block_size - 1);
+        if (trace.block != block_addr || now() > trace.last + 1) {
+            trace.block = block_addr;
+            trace.first = stat_cycles;
+        }
+        trace.last = now();
+    }
     
     // Step 1: Write Exclusion
     // Check if any *pending* write to this block exists in other MSHRs.
@@ -550,11 +1153,21 @@ bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
     }
     
     if (conflict) return false; // Stall and Retry
+
+    // Source throttling (FST): gate the issue of new misses
+    if (!parent_core->proc->fst.may_issue(id, now())) return false;
     
     // Step 2 & 3: L2 MSHR Checks
     // Check active MSHR in L2 (Step 2)
     int l2_mshr_idx = l2_ref->check_mshr(addr);
-    if (l2_mshr_idx != -1) return false; // Stall if L2 is already handling this (simplify: no merge for L1 initiated reqs per spec suggestion?)
+    if (l2_mshr_idx != -1) {
+        // Secondary read miss: ride on the pending fill (L2_MSHR_TARGETS > 1)
+        if (!is_write && l2_ref->add_target(l2_mshr_idx, id, !is_data_cache)) {
+            allocate_mshr(addr, false, -1, SHARED);
+            trace.merged = true;
+        }
+        return false; // Stall: merged reads wait for the fill, the rest retry once the MSHR frees
+    }
     // Spec Step 3: Check availability
     // We can't easily check "availability" without allocating, but we can check loop.
     // L2Cache has fixed size MSHR.
@@ -564,6 +1177,8 @@ bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
     bool l2_full = true;
     for(int i=0; i<L2_MSHR_SIZE; i++) { if(!l2_ref->mshrs[i].valid) { l2_full = false; break; } }
     if (l2_full) return false; // Stall
+
+    if (L2_PRIVATE) return access_private_l2(addr, is_write, pc);
     
     // Step 4: Probe Other L1 Caches
     bool found_shared = false;
@@ -575,16 +1190,18 @@ bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
         
         // Probe I-Cache
         bool m = false; 
-        if (core_ptr->icache.probe_coherence(addr, is_write, &m, &coherence_data)) {
+        if (core_ptr->icache.probe_coherence(addr, is_write, &m, &coherence_data, id)) {
             found_shared = true;
             if (m) found_modified = true;
+            OBSERVE(on_snoop, id, core_ptr->id, true, addr & ~(block_size - 1), is_write);
         }
         
         // Probe D-Cache
         m = false;
-        if (core_ptr->dcache.probe_coherence(addr, is_write, &m, &coherence_data)) {
+        if (core_ptr->dcache.probe_coherence(addr, is_write, &m, &coherence_data, id)) {
             found_shared = true;
             if (m) found_modified = true;
+            OBSERVE(on_snoop, id, core_ptr->id, false, addr & ~(block_size - 1), is_write);
         }
     }
 
@@ -602,35 +1219,24 @@ bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
              }
         }
         
-        mshr.valid = true;
-        mshr.address = addr & ~31;
-        mshr.is_write = is_write;
-        mshr.ready_cycle = stat_cycles + 5; 
-        
         // Determine Target State from Snoop
-        if (is_write) {
-            mshr.target_state = MODIFIED;
-        } else {
-            mshr.target_state = SHARED; // We found a copy, so we join as Shared
-        }
+        // If writing -> MODIFIED. If reading, we found a copy, so we join as Shared.
+        allocate_mshr(addr, is_write, uncore_ready(5), is_write ? MODIFIED : SHARED, MISS_SNOOP);
         
         return false; 
     }
     
     // Step 5: Probe L2
     if (l2_ref->probe_read(addr)) { // L2 Has it (Hit)
-         int res = l2_ref->access(addr, is_write, id);
+         int res = l2_ref->access(addr, is_write, id, pc);
          
          if (res == L2_HIT) {
-             mshr.valid = true;
-             mshr.address = addr & ~31;
-             mshr.is_write = is_write;
-             mshr.ready_cycle = stat_cycles + 5 + L2_HIT_LATENCY;
-             
              // L2 Hit State Logic:
              // If Write -> MODIFIED
              // If Read -> EXCLUSIVE (Since we passed snooping step without finding it Shared)
-             mshr.target_state = is_write ? MODIFIED : EXCLUSIVE;
+             // A dirty line leaving an exclusive L2 stays dirty in the L1
+             bool dirty = is_write || l2_ref->migrated_dirty;
+             allocate_mshr(addr, is_write, uncore_ready(5 + L2_HIT_LATENCY), dirty ? MODIFIED : EXCLUSIVE);
              
              return false;
          }
@@ -638,17 +1244,18 @@ bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
     
     // Step 6: Go to Memory
     // Allocates MSHR through L2 access logic
-    int res = l2_ref->access(addr, is_write, id);
+    int res = l2_ref->access(addr, is_write, id, pc);
+    if (res == L2_HIT) {
+         // Estimated hit in an unsampled L2 set (L2_SET_SAMPLING)
+         allocate_mshr(addr, is_write, uncore_ready(5 + L2_HIT_LATENCY), is_write ? MODIFIED : EXCLUSIVE);
+         return false;
+    }
     if (res == L2_MISS) {
-         mshr.valid = true;
-         mshr.address = addr & ~31;
-         mshr.is_write = is_write;
-         mshr.ready_cycle = -1; // Wait for callback
-         
          // DRAM Fill State Logic:
          // If Write -> MODIFIED
          // If Read -> EXCLUSIVE (First fetch)
-         mshr.target_state = is_write ? MODIFIED : EXCLUSIVE;
+         // ready_cycle = -1: Wait for callback
+         allocate_mshr(addr, is_write, -1, is_write ? MODIFIED : EXCLUSIVE);
          
          return false;
     }
@@ -656,23 +1263,156 @@ bool L1Cache::access(uint32_t addr, bool is_write, bool is_data_cache) {
     return false; // Should not reach here typically unless L2 Busy (checked earlier) or weird state
 }
 
+bool L1Cache::access_private_l2(uint32_t addr, bool is_write, uint32_t pc) {
+    // Another L2 fetching the line from DRAM would end up with a second exclusive copy
+    for (auto* l2 : parent_core->proc->l2s) {
+        if (l2 != l2_ref && l2->check_mshr(addr) != -1) return false; // Stall
+    }
+
+    // Own L2 holds the line with sufficient permission: no snoop needed
+    MESI_State local = l2_ref->state_of(addr);
+    if (local != INVALID && (!is_write || local == EXCLUSIVE || local == MODIFIED)) {
+        int res = l2_ref->access(addr, is_write, id, pc);
+        if (res != L2_HIT) return false;
+        if (is_write && l2_ref->state_of(addr) != INVALID) l2_ref->install_coherent(addr, MODIFIED);
+
+        MESI_State target = EXCLUSIVE;
+        if (is_write || l2_ref->migrated_dirty) target = MODIFIED;
+        else if (local == SHARED) target = SHARED;
+        allocate_mshr(addr, is_write, uncore_ready(5 + L2_HIT_LATENCY), target);
+        return false;
+    }
+
+    // Snoop the other private L2s (each covers its own L1s)
+    bool found_shared = false;
+    bool found_modified = false;
+    for (auto* l2 : parent_core->proc->l2s) {
+        if (l2 == l2_ref) continue;
+        bool m = false;
+        if (l2->probe_coherence(addr, is_write, &m, id)) {
+            found_shared = true;
+            if (m) found_modified = true;
+        }
+    }
+
+    if (found_shared || local != INVALID) {
+        // Cache-to-cache transfer, or an upgrade of our SHARED copy
+        if (found_modified && l2_ref->dram_ref) {
+            // "Immediately written into main memory", as for L1 snoops
+            l2_ref->dram_ref->enqueue(true, addr & ~(block_size - 1), -1, DRAM_Req::SRC_MEMORY, stat_cycles);
+        }
+        MESI_State target = is_write ? MODIFIED : SHARED;
+        l2_ref->install_coherent(addr, target);
+        if (local == INVALID) l2_ref->stat_remote_hits++;
+
+        uint32_t latency = (local == INVALID) ? L2_SNOOP_LATENCY : L2_HIT_LATENCY;
+        allocate_mshr(addr, is_write, uncore_ready(5 + latency), target, local == INVALID ? MISS_SNOOP : MISS_L2);
+        return false;
+    }
+
+    // Miss in every L2: fetch from DRAM through our L2
+    int res = l2_ref->access(addr, is_write, id, pc);
+    if (res == L2_MISS) {
+        allocate_mshr(addr, is_write, -1, is_write ? MODIFIED : EXCLUSIVE);
+    }
+    return false;
+}
+
+bool L1Cache::is_icache() const {
+    return this == &parent_core->icache;
+}
+
+void L1Cache::evict(uint32_t set_idx, int way, bool* dirty_evicted, uint32_t* evicted_addr, std::vector<uint8_t>* evicted_data, bool writeback_clean) {
+    const CacheBlock& blk = sets[set_idx].blocks[way];
+    if (blk.state != INVALID) {
+        OBSERVE(on_l1_evict, id, is_icache(), (blk.tag << tag_shift) | (set_idx << index_shift), blk.dirty);
+    }
+    Cache::evict(set_idx, way, dirty_evicted, evicted_addr, evicted_data, writeback_clean);
+}
+
+uint64_t L1Cache::now() const {
+    return parent_core->clock.cycles;
+}
+
+uint64_t L1Cache::uncore_ready(uint32_t uncore_cycles) const {
+    // Request and response each cross the core/uncore boundary
+    const ClockDomain& core_clk = parent_core->clock;
+    return now() + core_clk.from(uncore_cycles, l2_ref->clock) + 2 * core_clk.crossing(l2_ref->clock);
+}
+
+void L1Cache::respond(uint32_t addr, MESI_State target_state, const FillTrace* fill_trace) {
+    if (!mshr.valid || mshr.address != (addr & ~(block_size - 1))) return;
+    if (MISS_LATENCY_PROFILE && fill_trace) trace.fill = *fill_trace;
+
+    uint64_t sync = parent_core->clock.crossing(l2_ref->clock);
+    if (sync == 0) {
+        fill(addr, target_state);
+    } else {
+        // Completed through the synchronizer by the access path
+        mshr.ready_cycle = now() + sync;
+        mshr.target_state = target_state;
+    }
+}
+
+void L1Cache::allocate_mshr(uint32_t addr, bool is_write, uint64_t ready_cycle, MESI_State target_state, MissPath path) {
+    mshr.valid = true;
+    mshr.address = addr & ~(block_size - 1);
+    mshr.is_write = is_write;
+    mshr.ready_cycle = ready_cycle;
+    mshr.target_state = target_state;
+    stat_misses++;
+    OBSERVE(on_l1_miss, id, is_icache(), mshr.address, is_write);
+
+    // Re-reference of a line the L2 inclusion policy took away
+    uint32_t& slot = inclusion_filter[(mshr.address >> index_shift) % TLA_FILTER_SIZE];
+    if (slot != 0 && (slot & ~1u) == mshr.address) {
+        if (slot & 1) stat_eci_rereferences++;
+        else stat_harmful_back_invals++;
+        slot = 0;
+    }
+
+    energy.charge_tag(); // Lookup that missed
+    parent_core->proc->fst.on_issue(id, now());
+
+    if (MISS_LATENCY_PROFILE) {
+        trace.issue = stat_cycles;
+        trace.path = (ready_cycle == (uint64_t)-1) ? MISS_DRAM : path;
+        trace.merged = false;
+        trace.fill = FillTrace();
+    }
+}
+
 void L1Cache::fill(uint32_t addr, MESI_State target_state) {
     if (mshr.valid && mshr.address == (addr & ~(block_size - 1))) {
         bool dirty_evicted;
         uint32_t evicted_addr;
         std::vector<uint8_t> evicted_data;
-        bool wb_clean = (l2_ref->incl_policy == INCL_EXCLUSIVE);
+        // Clean victims are offered to the L2 only if it may be exclusive for them
+        bool wb_clean = (l2_ref->incl_policy == INCL_EXCLUSIVE || l2_ref->incl_policy == INCL_FLEX);
         
         CacheBlock* blk = install(addr, nullptr, &dirty_evicted, &evicted_addr, &evicted_data, wb_clean);
+        energy.charge_write();
         if (blk) {
             blk->state = target_state;
             if (target_state == MODIFIED) blk->dirty = true;
         }
+        OBSERVE(on_l1_fill, id, is_icache(), mshr.address, target_state);
+        if (MISS_LATENCY_PROFILE) {
+            LatencyType type = is_icache() ? LAT_IFETCH : (mshr.is_write ? LAT_STORE : LAT_LOAD);
+            parent_core->proc->latency.record(id, type, trace);
+            trace.block = 1; // Next miss starts a new trace
+        }
+
+        // Displacing the linked line breaks the LL/SC reservation
+        drop_displaced_link();
 
+        bool clean_victim = wb_clean && !dirty_evicted && evicted_data.size() > 0 &&
+                            l2_ref->policy_for(evicted_addr) == INCL_EXCLUSIVE;
+        if (dirty_evicted || clean_victim) energy.charge_read();
         if (dirty_evicted) {
              l2_ref->handle_l1_writeback(evicted_addr, evicted_data);
-        } else if (wb_clean && evicted_data.size() > 0) {
-             l2_ref->handle_l1_writeback(evicted_addr, evicted_data);
+        } else if (clean_victim) {
+             l2_ref->handle_l1_writeback(evicted_addr, evicted_data, false);
         }
         
         mshr.valid = false;
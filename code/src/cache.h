@@ -4,6 +4,9 @@
 #include "config.h"
 #include "dram.h"
 #include "mshr.h"
+#include "energy.h"
+#include "dbp.h"
+#include "latency.h"
 #include <memory>
 
 /* Usage:
@@ -29,9 +32,20 @@ enum ReplacementPolicy {
 enum InclusionPolicy {
     INCL_INCLUSIVE = 0,
     INCL_EXCLUSIVE = 1,
-    INCL_NINE = 2 /* Non-Inclusive Non-Exclusive */
+    INCL_NINE = 2, /* Non-Inclusive Non-Exclusive */
+    INCL_FLEX = 3  /* FLEXclusion: inclusive or exclusive per set, chosen by set dueling */
 };
 
+enum TLAPolicy {
+    TLA_NONE = 0,
+    TLA_TLH = 1, /* Temporal Locality Hints: L1 hits update L2 replacement state */
+    TLA_ECI = 2, /* Early Core Invalidation of the next L2 victim on each fill */
+    TLA_QBS = 3  /* Query Based Selection: skip L2 victims resident in an L1 */
+};
+
+/* The policies pick victims by LRU position, which fills leave unchanged unless they age the set */
+static_assert(TLA_POLICY == TLA_NONE || LRU_INSTALL_AGING, "TLA_POLICY needs LRU_INSTALL_AGING 1");
+
 enum L2_Access_Status {
     L2_BUSY = 0,
     L2_HIT = 1,
@@ -43,9 +57,11 @@ struct CacheBlock {
     MESI_State state;
     bool dirty;        /* Mostly for L2, but L1 uses state=MODIFIED */
     uint32_t lru_count; /* For LRU replacement */
+    int owner;         /* L2: core whose miss brought the block in */
+    bool dead;         /* L2: predicted dead after its last touch */
     std::vector<uint8_t> data; /* Data storage */
 
-    CacheBlock(uint32_t size = 32) : tag(0), state(INVALID), dirty(false), lru_count(0) {
+    CacheBlock(uint32_t size = 32) : tag(0), state(INVALID), dirty(false), lru_count(0), owner(-1), dead(false) {
         data.resize(size, 0);
     }
     
@@ -90,10 +106,15 @@ public:
     uint32_t tag_shift;   
 
     ReplacementPolicy repl_policy; 
+    mutable uint32_t rng_state; /* REPL_RANDOM */
     
     std::vector<CacheSet> sets; 
 
-    Cache(uint32_t s, uint32_t w, uint32_t b);
+    /* Energy accounting (tag/data/snoop events) */
+    CacheEnergy energy;
+
+    /* sample_ratio > 1 allocates blocks only for a hashed 1-in-N subset of sets */
+    Cache(uint32_t s, uint32_t w, uint32_t b, uint32_t sample_ratio = 1);
     virtual ~Cache() {}
 
     uint32_t get_index(uint32_t addr) const {
@@ -108,13 +129,17 @@ public:
         return addr & (block_size - 1);
     }
 
+    /* Set sampling: true if the set holds blocks */
+    static bool sampled_set(uint32_t set_idx, uint32_t ratio);
+    bool modelled(uint32_t set_idx) const { return !sets[set_idx].blocks.empty(); }
+
     /* Helper: Find block in a set. Returns way index or -1 */
     int find_block(uint32_t set_idx, uint32_t tag) const;
     
     /* Helper: Update LRU on access */
     void update_lru(uint32_t set_idx, int way);
     
-    /* Helper: Find victim for eviction (LRU). Virtual for policy override. */
+    /* Helper: Find victim for eviction (repl_policy). Virtual for policy override. */
     virtual int find_victim(uint32_t set_idx) const;
     
     /* Core Methods */
@@ -135,9 +160,38 @@ public:
     virtual void evict(uint32_t set_idx, int way, bool* dirty_evicted, uint32_t* evicted_addr, std::vector<uint8_t>* evicted_data, bool writeback_clean = false);
 };
 
+const char* repl_policy_name(ReplacementPolicy p);
+
+struct ShadowConfig {
+    uint32_t sets;
+    uint32_t ways;
+    ReplacementPolicy repl;
+};
+
+/* Tag-only alternative L2 (SHADOW_L2_ENABLE). Sees the same demand accesses
+ * and L1 writebacks as the real L2 and counts its own hits, misses and
+ * writebacks. It never responds, so it cannot affect timing. */
+class ShadowCache : public Cache {
+public:
+    ShadowCache(const ShadowConfig& c);
+
+    void access(uint32_t addr, bool is_write);
+    void writeback(uint32_t addr);
+
+    uint64_t stat_accesses;
+    uint64_t stat_misses;
+    uint64_t stat_writebacks; /* Dirty evictions and bypassed L1 writebacks */
+};
+
 class L2Cache : public Cache {
 public:
     InclusionPolicy incl_policy; // Configured via L2_INCL_POLICY
+
+    // FLEXclusion state: follower sets use flex_mode
+    uint32_t flex_psel;       // High: inclusive leaders miss more than exclusive leaders cost
+    InclusionPolicy flex_mode;
+    uint64_t stat_flex_switches;
+    bool migrated_dirty;      // Last access hit a dirty line and moved it to the L1 (exclusive)
     std::vector<class L1Cache*> l1_refs; // Pointers to L1s for invalidation/snooping
     
     // MSHRs
@@ -146,6 +200,9 @@ public:
     // DRAM Reference for Misses
     struct DRAM* dram_ref; // Forward decl
 
+    // Uncore clock domain (L2 latencies and queues are in uncore cycles)
+    ClockDomain clock;
+
     // Delay Queues for Timing Specs
     struct Req_Queue_Item {
         bool is_write;
@@ -161,10 +218,42 @@ public:
     };
     std::vector<Ret_Queue_Item> ret_queue;
 
-    L2Cache(struct DRAM* dram); 
+    // Inter-core interference (uncore cycles): [victim][interferer]. Read by FST.
+    // A miss on a line another core's fill evicted is charged FST_MISS_PENALTY.
+    uint64_t stat_interference[NUM_CORES][NUM_CORES];
+    int8_t pollution_filter[NUM_CORES][FST_POLLUTION_FILTER_SIZE]; // Evicting core, -1 if none
+    int fill_core; // Requester of the fill currently being installed
+    bool warming;  // Functional warming install in progress: no DRAM traffic
+
+    // Dead-block predictor (trained on demand accesses, PC signatures)
+    DeadBlockPredictor dbp;
+
+    // Inclusion statistics
+    uint64_t stat_back_invals;   // L1 copies removed by L2 evictions
+    uint64_t stat_eci_invals;    // L1 copies removed early (TLA_ECI)
+    uint64_t stat_tlh_hints;     // L1 hit hints received (TLA_TLH)
+    uint64_t stat_remote_hits;   // Misses served by another private L2 (L2_PRIVATE)
+    uint64_t stat_mshr_merges;   // Secondary misses merged into a pending MSHR
+    uint64_t stat_misses[NUM_CORES]; // New MSHR allocations, by requesting core
+    mutable uint64_t stat_qbs_skips; // Victim candidates skipped as L1-resident (TLA_QBS)
+    uint64_t stat_writebacks;    // Lines written back to DRAM
+    uint64_t stat_demand_accesses; // L1 misses looked up (merges and MSHR stalls excluded)
+
+    // Shadow tag arrays for alternative configurations (SHADOW_L2_CONFIGS)
+    std::vector<ShadowCache> shadows;
+
+    // Set sampling (L2_SET_SAMPLING): accesses to unsampled sets hit or miss
+    // at the recent miss rate of the sampled sets (moving averages)
+    double sampled_miss_rate;
+    double sampled_dirty_rate;  // Fills that evicted a dirty line
+    uint64_t stat_sampled_accesses, stat_sampled_misses;
+    uint64_t stat_estimated_accesses, stat_estimated_misses;
+    uint32_t estimate_rng;
+
+    L2Cache(struct DRAM* dram, uint32_t num_sets = L2_SETS); 
     
     // Returns L2_RET_xxx status
-    int access(uint32_t addr, bool is_write, int core_id);
+    int access(uint32_t addr, bool is_write, int core_id, uint32_t pc);
 
 
 
@@ -174,13 +263,58 @@ public:
     // Handler for DRAM completion
     void handle_dram_completion(uint32_t addr);
     
+    // Set sampling: uniform draw in [0, 1)
+    double estimate_draw();
+
+    // Pollution filter slot of a block address
+    uint32_t pollution_index(uint32_t addr) const;
+
+    // Effective inclusion policy of a set / block (resolves INCL_FLEX)
+    InclusionPolicy policy_for_set(uint32_t set_idx) const;
+    InclusionPolicy policy_for(uint32_t addr) const { return policy_for_set(get_index(addr)); }
+
+    // FLEXclusion: charges a leader-set event to the policy selector
+    void flex_record(uint32_t set_idx, uint32_t cost);
+
+    // TLA: L1 hit hint (promotes the block in L2 LRU)
+    void hint(uint32_t addr);
+
+    // TLA: true if any L1 holds the block (QBS query)
+    bool in_l1(uint32_t addr) const;
+
+    // TLA: invalidates the L1 copies of the next victim in a set (ECI)
+    void early_invalidate(uint32_t set_idx);
+
     // MSHR Helpers
     int check_mshr(uint32_t addr);
-    int allocate_mshr(uint32_t addr, bool is_write, int core_id);
+    int allocate_mshr(uint32_t addr, bool is_write, int core_id, uint32_t pc);
+    // Adds a secondary read miss to a pending MSHR. False if it cannot merge (stall).
+    bool add_target(int mshr_idx, int core_id, bool is_icache);
     void complete_mshr(uint32_t addr, std::vector<std::unique_ptr<class Core>>& cores);
     
     // Writeback Helper
-    void handle_l1_writeback(uint32_t addr, const std::vector<uint8_t>& data);
+    // Exclusive sets install the victim (clean or dirty); other sets only write dirty data
+    void handle_l1_writeback(uint32_t addr, const std::vector<uint8_t>& data, bool dirty = true);
+
+    // Private L2 snoop (L2_PRIVATE): probes this L2 and the L1s it includes.
+    // is_write_req invalidates every copy, otherwise copies are downgraded to SHARED.
+    // Returns true if any copy was present; is_modified if one was dirty.
+    // requester: core whose miss caused the snoop (-1 for back-invalidations)
+    bool probe_coherence(uint32_t addr, bool is_write_req, bool* is_modified, int requester = -1);
+
+    // Private L2: state of a resident block (INVALID if absent), no LRU update
+    MESI_State state_of(uint32_t addr) const;
+
+    // Private L2: installs a block received from another L2 or upgrades it in place
+    void install_coherent(uint32_t addr, MESI_State state);
+
+    // Functional warming (SMARTS): updates tags and LRU as a demand fill in
+    // the given L1 state would, with no timing, MSHRs or DRAM traffic
+    void warm(uint32_t addr, MESI_State state);
+    void warm_writeback(uint32_t addr, bool dirty);
+
+    // Prefers predicted-dead blocks when DBP_ENABLE
+    int find_victim(uint32_t set_idx) const override;
 
     // Override evict for Inclusive Policy
     void evict(uint32_t set_idx, int way, bool* dirty_evicted, uint32_t* evicted_addr, std::vector<uint8_t>* evicted_data, bool writeback_clean = false) override;
@@ -197,11 +331,48 @@ public:
     // Parent core pointer for snooping other L1s
     class Core* parent_core;
 
+    // Lines removed by the L2 inclusion policy (block address, bit 0 = early
+    // invalidation), to count misses that re-reference them
+    std::vector<uint32_t> inclusion_filter;
+    uint64_t stat_harmful_back_invals; // Misses on lines back-invalidated by an L2 eviction
+    uint64_t stat_eci_rereferences;    // Misses on lines invalidated early (TLA_ECI)
+    uint64_t stat_misses;              // Misses (MSHR allocations, including upgrades)
+    uint64_t stat_hits;
+
+    // Miss being timed (MISS_LATENCY_PROFILE)
+    MissTrace trace;
+
     L1Cache(int core_id, L2Cache* l2, class Core* core, uint32_t s, uint32_t w);
     
     // Returns true if hit/available. False if miss/pending.
-    bool access(uint32_t addr, bool is_write, bool is_data_cache);
+    // pc: requesting instruction, passed on to the L2
+    bool access(uint32_t addr, bool is_write, bool is_data_cache, uint32_t pc);
+
+    // True if access() would hit now (no pending miss, block present with permission)
+    bool would_hit(uint32_t addr, bool is_write) const;
+
+    bool is_icache() const;
+
+    // Reports evictions to observers (OBSERVER_ENABLE)
+    void evict(uint32_t set_idx, int way, bool* dirty_evicted, uint32_t* evicted_addr, std::vector<uint8_t>* evicted_data, bool writeback_clean = false) override;
+
+    // Miss handling with private L2s (L2_PRIVATE): own L2, then the other L2s, then DRAM
+    bool access_private_l2(uint32_t addr, bool is_write, uint32_t pc);
     
+    // Records a new miss in the MSHR (ready_cycle = -1: wait for L2 callback)
+    // path: where a miss with a known ready_cycle is served
+    void allocate_mshr(uint32_t addr, bool is_write, uint64_t ready_cycle, MESI_State target_state, MissPath path = MISS_L2);
+
+    // Current cycle of the owning core's clock domain
+    uint64_t now() const;
+
+    // Core-cycle at which an operation taking uncore_cycles in the uncore completes
+    uint64_t uncore_ready(uint32_t uncore_cycles) const;
+
+    // Called by L2 on miss completion: fills now, or after the synchronizer
+    // delay if the core and uncore clocks differ. fill: DRAM timing of the miss
+    void respond(uint32_t addr, MESI_State target_state, const FillTrace* fill = nullptr);
+
     // Called when L2 fills the request
     // target_state: State to install the block in (SHARED/EXCLUSIVE/MODIFIED)
     void fill(uint32_t addr, MESI_State target_state);
@@ -209,6 +380,16 @@ public:
     // Invalidate a specific block (used by L2 for Inclusive Policy / Coherence)
     // Returns true if block was present and valid
     bool invalidate(uint32_t addr);
+
+    // Functional warming (SMARTS): performs the tag, LRU and coherence state
+    // changes of an access without timing
+    void warm(uint32_t addr, bool is_write);
+
+    // Breaks the core's LL link if its line is no longer in this L1D
+    void drop_displaced_link();
+
+    // Records a line removed by the L2 inclusion policy
+    void note_inclusion_victim(uint32_t addr, bool early);
     
     // Coherence Snoop (used by other L1s)
     // Returns true if block was present (Shared/Exclusive/Modified).
@@ -216,7 +397,7 @@ public:
     //               If false, downgrades to Shared (Read Miss).
     // is_modified: Output, set to true if block was in MODIFIED state.
     // data: Output, populated with dirty data if is_modified is true.
-    bool probe_coherence(uint32_t addr, bool is_write_req, bool* is_modified, std::vector<uint8_t>* data);
+    bool probe_coherence(uint32_t addr, bool is_write_req, bool* is_modified, std::vector<uint8_t>* data, int requester = -1);
 };
 
 #endif
@@ -0,0 +1,28 @@
+#include "clock.h"
+
+struct VF_Point {
+    uint32_t mhz;
+    uint32_t mv;
+};
+
+static const VF_Point vf_table[] = DVFS_VF_TABLE;
+static const int vf_table_size = sizeof(vf_table) / sizeof(vf_table[0]);
+
+ClockDomain::ClockDomain(uint32_t mhz) : freq_mhz(0), voltage_mv(DVFS_NOMINAL_MV), cycles(0), phase(0), leak_ns(0) {
+    set_freq(mhz);
+}
+
+void ClockDomain::set_freq(uint32_t mhz) {
+    if (mhz == 0) mhz = 1;
+    if (mhz > CLOCK_FREQ_MHZ) mhz = CLOCK_FREQ_MHZ;
+    freq_mhz = mhz;
+
+    // Lowest operating point that supports this frequency
+    voltage_mv = vf_table[vf_table_size - 1].mv;
+    for (int i = 0; i < vf_table_size; i++) {
+        if (vf_table[i].mhz >= mhz) {
+            voltage_mv = vf_table[i].mv;
+            break;
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+#include "config.h"
+#include <cstdint>
+
+/* A clock domain derived from the base clock (CLOCK_FREQ_MHZ, one tick per
+ * stat_cycles increment). A domain running at f MHz produces f/CLOCK_FREQ_MHZ
+ * local edges per base cycle; components in the domain only advance on its
+ * edges and express their latencies in local cycles. */
+struct ClockDomain {
+    uint32_t freq_mhz;
+    uint32_t voltage_mv;
+    uint64_t cycles;  /* Local cycles elapsed */
+    uint32_t phase;   /* Fractional-divider accumulator */
+    double leak_ns;   /* Elapsed time weighted by V/V_nominal (leakage integral) */
+
+    ClockDomain(uint32_t mhz = CLOCK_FREQ_MHZ);
+
+    /* Advance by one base cycle. Returns true on a local clock edge. */
+    bool tick() {
+        leak_ns += (1000.0 / CLOCK_FREQ_MHZ) * voltage_mv / DVFS_NOMINAL_MV;
+        phase += freq_mhz;
+        if (phase >= CLOCK_FREQ_MHZ) {
+            phase -= CLOCK_FREQ_MHZ;
+            cycles++;
+            return true;
+        }
+        return false;
+    }
+
+    /* Advance by n base cycles at once (idle skipping) */
+    void advance(uint64_t n) {
+        leak_ns += n * (1000.0 / CLOCK_FREQ_MHZ) * voltage_mv / DVFS_NOMINAL_MV;
+        uint64_t p = phase + n * freq_mhz;
+        cycles += p / CLOCK_FREQ_MHZ;
+        phase = p % CLOCK_FREQ_MHZ;
+    }
+
+    /* DVFS: change frequency (clamped to the base clock), voltage from DVFS_VF_TABLE */
+    void set_freq(uint32_t mhz);
+
+    /* Dynamic energy scale relative to nominal voltage: (V/V_nom)^2 */
+    double dynamic_scale() const {
+        double v = (double)voltage_mv / DVFS_NOMINAL_MV;
+        return v * v;
+    }
+
+    /* n cycles of domain src, expressed in this domain's cycles (rounded up) */
+    uint64_t from(uint64_t n, const ClockDomain& src) const {
+        if (src.freq_mhz == freq_mhz) return n;
+        return (n * freq_mhz + src.freq_mhz - 1) / src.freq_mhz;
+    }
+
+    /* Synchronizer penalty, in this domain's cycles, for a crossing to/from dst.
+     * Domains at the same frequency are clocked synchronously (no penalty). */
+    uint64_t crossing(const ClockDomain& dst) const {
+        if (dst.freq_mhz == freq_mhz) return 0;
+        return from(CLOCK_SYNC_CYCLES, dst);
+    }
+};
+
+#endif
@@ -27,6 +27,7 @@
 #define DRAM_ROWS 32768     /* Rows per Bank */
 #define DRAM_ROW_SIZE 2048  /* Bytes per Row */
 #define BLOCK_SIZE 32       /* Cache Line Size */
+#define DRAM_BANK_SHIFT 5   /* Lowest address bit of the bank index (Bank = [7:5]) */
 
 /* Derived for internal array sizing if needed */
 #define TOTAL_BANKS (DRAM_CHANNELS * DRAM_RANKS * DRAM_BANKS)
@@ -54,18 +55,165 @@
 #define L2_SIZE 262144
 #define L2_ASSOC 16
 #define L2_SETS (L2_SIZE / (L2_ASSOC * BLOCK_SIZE))
-#define L2_INCL_POLICY INCL_INCLUSIVE /* Inclusive */
+#define L2_INCL_POLICY INCL_INCLUSIVE /* Inclusive. INCL_FLEX = switch between inclusive and exclusive at run time */
+/* INCL_EXCLUSIVE installs clean L1 victims in the L2 and fills migrated dirty lines MODIFIED
+ * (a true victim cache); its results differ from versions that sent clean victims to DRAM */
 #define L2_MSHR_SIZE 16 /* Number of MSHRs */
+#define L2_MSHR_TARGETS 1 /* Requests one L2 MSHR can serve; > 1 merges other cores' read misses to a pending line */
+#define L2_PRIVATE 0    /* 1 = one private L2 per core, kept coherent by snooping at the L2 level; DRAM behind */
+#define L2_PRIVATE_SIZE (L2_SIZE / NUM_CORES) /* Capacity of each private L2 (same total as shared) */
+#define L2_SNOOP_LATENCY 20 /* Uncore cycles for a cache-to-cache transfer from another private L2 */
+#define L2_SET_SAMPLING 0 /* N > 1 = hold tags for a hashed 1-in-N subset of shared L2 sets; other sets hit or miss at the sampled miss rate */
+#define L2_SAMPLING_WINDOW 64 /* Sampled accesses averaged into the miss-rate estimate */
+/* Approximation: a dirty eviction estimated for an unsampled set writes back an invented line,
+ * the fill's address with its lowest tag bit flipped. Its bank and row are not those of a real
+ * victim, so DRAM row-buffer hits and conflicts of these writebacks are approximate. */
 
 /* Policies */
-/* Replace with 0 (LRU), 1 (Random), etc. */
+/* REPL_LRU, REPL_RANDOM, REPL_FIFO or REPL_MRU */
 #define CACHE_REPL_POLICY REPL_LRU // LRU
+#define LRU_INSTALL_AGING 0 /* 1 = a fill ages the other lines of its set like a hit does (true LRU order); 0 = only hits age lines */
+
+/* Shadow L2 tag arrays: tag-only L2s fed the real L2's access stream, for
+ * comparing configurations in one run (reported by rdump).
+ * Each entry is {sets, ways, replacement policy}. */
+#define SHADOW_L2_ENABLE 0
+#define SHADOW_L2_CONFIGS {                      \
+    {L2_SETS, L2_ASSOC, REPL_LRU},               \
+    {L2_SETS, L2_ASSOC, REPL_RANDOM},            \
+    {L2_SETS, L2_ASSOC, REPL_FIFO},              \
+    {L2_SETS, L2_ASSOC, REPL_MRU},               \
+    {L2_SETS * 2, L2_ASSOC, REPL_LRU},           \
+    {L2_SETS, L2_ASSOC / 2, REPL_LRU}            \
+}
+
+/* FLEXclusion (L2_INCL_POLICY INCL_FLEX): set dueling between inclusive and exclusive */
+#define FLEX_LEADER_STRIDE 32  /* One inclusive and one exclusive leader set per FLEX_LEADER_STRIDE sets */
+#define FLEX_PSEL_BITS 10      /* Policy selector width */
+#define FLEX_MISS_COST 4       /* PSEL weight of an L2 miss in a leader set */
+#define FLEX_TRAFFIC_COST 1    /* PSEL weight of a clean L1 victim moved into an exclusive leader */
+
+/* Temporal-Locality-Aware inclusion (INCL_INCLUSIVE only) */
+/* Enums defined in cache.h */
+#define TLA_POLICY TLA_NONE    /* TLA_NONE, TLA_TLH (L1 hit hints), TLA_ECI (early core invalidation), TLA_QBS (query-based selection) */
+#define TLA_QBS_MAX_QUERIES 2  /* L2 victim candidates queried before falling back to LRU */
+#define TLA_FILTER_SIZE 1024   /* Per-L1 filter of lines removed by inclusion, for re-reference counters */
+#define INCL_STATS 0           /* 1 = report back-invalidation counters even with TLA_NONE */
+
+/* Dead-Block Prediction (L2) */
+#define DBP_ENABLE 0           /* 1 = prefer predicted-dead lines as L2 victims */
+#define DBP_BYPASS 1           /* Skip L2 allocation for fills predicted dead (not with INCL_INCLUSIVE) */
+#define DBP_SAMPLER_SETS 32    /* L2 sets shadowed by the sampler */
+#define DBP_SAMPLER_ASSOC 12   /* Sampler associativity */
+#define DBP_TABLES 3           /* Skewed counter tables */
+#define DBP_TABLE_SIZE 4096    /* Counters per table */
+#define DBP_COUNTER_BITS 2     /* Saturating counter width */
+#define DBP_THRESHOLD 8        /* Predict dead when the counter sum reaches this */
 
 /* L2 Latencies */
 #define L2_HIT_LATENCY 15
 #define L2_TO_DRAM_DELAY 5
 #define DRAM_TO_L2_DELAY 5
 
+/* Virtual Memory / Physical Page Allocation */
+/* Enums defined in vmem.h */
+#define PAGE_SIZE 4096
+#define PHYS_MEM_SIZE (TOTAL_BANKS * DRAM_ROWS * DRAM_ROW_SIZE) /* 512MB of physical frames */
+#define PAGE_ALLOC_POLICY PAGE_ALLOC_IDENTITY /* IDENTITY, SEQUENTIAL, RANDOM, BANK_SPREAD, BANK_ISOLATE, L2_COLOR */
+#define PAGE_ALLOC_SEED 1 /* Seed for PAGE_ALLOC_RANDOM */
+/* Note: bank colouring needs DRAM_BANK_SHIFT >= log2(PAGE_SIZE) (e.g. 12), otherwise every page spans all banks. */
+
+/* Clock Domains / DVFS */
+#define CLOCK_FREQ_MHZ 2000   /* Base clock: one stat_cycles tick. No domain may run faster. */
+#define CORE_FREQ_MHZ CLOCK_FREQ_MHZ   /* Initial frequency of every core */
+#define UNCORE_FREQ_MHZ CLOCK_FREQ_MHZ /* L2, its queues and the snoop bus */
+#define DRAM_FREQ_MHZ CLOCK_FREQ_MHZ   /* DRAM controller and timing parameters */
+#define CLOCK_SYNC_CYCLES 2   /* Synchronizer delay (destination cycles) on asynchronous crossings */
+#define DVFS_NOMINAL_MV 1100  /* Voltage at which energy parameters are specified */
+#define DVFS_VF_TABLE { {500, 750}, {1000, 850}, {1500, 975}, {2000, 1100} } /* {MHz, mV} */
+
+/* Fairness via Source Throttling (FST) */
+#define FST_ENABLE 0
+#define FST_INTERVAL 100000          /* Base cycles between throttling decisions */
+#define FST_UNFAIRNESS_TARGET 1.4    /* Throttle while max/min slowdown exceeds this */
+#define FST_LEVELS {10, 25, 50, 75, 100} /* Injection rate, % of unthrottled */
+#define FST_ISSUE_GAP 50             /* Core cycles between misses at 50% (scales with level) */
+#define FST_MISS_PENALTY 200         /* Excess cycles charged per inter-core L2 contention miss */
+#define FST_POLLUTION_FILTER_SIZE 4096 /* Per-core filter of lines evicted by other cores */
+
+/* Cache Energy Model (reported by rdump) */
+#define ENERGY_MODEL 0              /* 1 = report cache energy and EDP */
+#define ENERGY_TAG_PJ_PER_BIT 0.02  /* Tag array read, per bit, 64-set reference array */
+#define ENERGY_DATA_PJ_PER_BIT 0.05 /* Data array read, per bit, 64-set reference array */
+#define ENERGY_WRITE_FACTOR 1.2     /* Write energy relative to read */
+#define ENERGY_LEAK_NW_PER_BIT 50.0 /* Leakage power per stored bit */
+/* Per-geometry overrides, CACTI style:
+ * {sets, ways, block, tag_nj, read_nj, write_nj, snoop_nj, leakage_mw}, e.g.
+ * { {512, 16, 32, 0.020, 0.110, 0.130, 0.020, 95.0} } */
+#define CACHE_ENERGY_TABLE {}
+
+/* Interval core model: instructions execute functionally and timing is
+ * charged per miss event instead of simulating the pipeline stages. The
+ * caches and DRAM stay detailed. */
+#define INTERVAL_CORE 0
+#define INTERVAL_BATCH 64             /* Most instructions per core call */
+#define INTERVAL_BRANCH_PENALTY 2     /* Taken branch: fetch slots squashed (predict not-taken) */
+#define INTERVAL_SERIALIZE_PENALTY 3  /* Syscall waits for the pipeline to drain */
+
+/* Region of Interest (syscall 0x40 begins, 0x41 ends; reported by rdump) */
+#define ROI_FAST_FORWARD 0      /* 1 = execute functionally outside the ROI, with full timing inside */
+#define ROI_PER_CORE 0          /* 0 = one global ROI, first begin to last end; 1 = each core has its own */
+#define ROI_FUNCTIONAL_BATCH 64 /* Instructions per core cycle while fast-forwarding */
+
+/* Dynamic binary translation of the functional path */
+#define DBT_ENABLE 0
+#define DBT_HOT_THRESHOLD 16    /* Entries into a block start before it is translated */
+#define DBT_MAX_BLOCK 64        /* Instructions per translated block */
+
+/* SMARTS statistical sampling (reported by rdump) */
+#define SMARTS_ENABLE 0
+#define SMARTS_PERIOD 100000    /* Instructions from one measured unit to the next */
+#define SMARTS_WARMUP 2000      /* Detailed warmup instructions before each unit */
+#define SMARTS_UNIT 1000        /* Measured instructions per unit */
+#define SMARTS_TARGET_ERROR 0.03 /* CPI confidence half-width, relative to the mean */
+#define SMARTS_Z 3.0            /* Confidence coefficient (3.0 = 99.7%) */
+#define SMARTS_MIN_SAMPLES 30   /* Units before the period adapts */
+#define FUNCTIONAL_WARM 0       /* 1 = keep caches warm during functional execution (implied by SMARTS_ENABLE) */
+
+/* Reuse-distance profiling: miss-ratio curves of the L1D and L2 streams
+ * (predicted ratios in rdump, full curves with "mrc <file>") */
+#define RD_PROFILE 0
+#define RD_MAX_SETS_LOG2 12     /* Set-associative curves for 1 .. 2^12 sets */
+#define RD_MAX_ASSOC 32         /* Deepest per-set LRU stack tracked */
+
+/* False-sharing detection (reported by rdump) */
+#define FALSE_SHARING_DETECT 0
+#define FALSE_SHARING_MIN_EVENTS 4    /* Invalidations + downgrades before a line can be flagged */
+#define FALSE_SHARING_REPORT_LINES 8  /* Flagged lines listed, most false events first */
+
+/* End-to-end L1 miss latency attribution by stage (reported by rdump) */
+#define MISS_LATENCY_PROFILE 0
+
+/* Epoch time series (shell "epoch n file") */
+#define EPOCH_OCCUPANCY_SAMPLE 16 /* Base cycles between MSHR/DRAM queue occupancy samples */
+
+/* Synchronization */
+#define BARRIER_LATENCY 50      /* Base cycles from the last barrier arrival (syscall 0x50) to release */
+
+/* Console output (syscall 11 prints, DEBUG traces) */
+#define CONSOLE_ASYNC 0             /* 1 = per-core buffers drained by a writer thread */
+#define CONSOLE_BUFFER_BYTES 65536  /* Pending bytes that trigger a handoff to the writer */
+#define CONSOLE_FILE ""             /* Writer output file; "" = stdout */
+
+/* Observer hooks (src/observer.h): 0 compiles every hook out */
+#define OBSERVER_ENABLE 0
+
+/* Result cache: a piped command script whose (simulator binary, program
+ * files, script) hash was run before replays the stored output instead of
+ * simulating. The binary stands in for the whole compile-time configuration. */
+#define RESULT_CACHE 0
+#define RESULT_CACHE_DIR ".simcache"
+
 /* DRAM Page Policy */
 #define DRAM_PAGE_POLICY 0  // 0 = Open Row, 1 = Closed Row
 
@@ -0,0 +1,119 @@
+#include "console.h"
+#include "shell.h"
+#include <algorithm>
+#include <cstdarg>
+
+Console console;
+
+Console::Console()
+    : stat_lines(0), stat_batches(0), channels(NUM_CORES + 1), pending_bytes(0), seq(0),
+      busy(false), stop(false), out(nullptr)
+{}
+
+Console::~Console() {
+    if (!writer.joinable()) return;
+    flush();
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stop = true;
+    }
+    work.notify_one();
+    writer.join();
+    if (out != stdout) fclose(out);
+}
+
+void Console::print(int channel, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    stat_lines++;
+
+    if (!CONSOLE_ASYNC) {
+        vprintf(fmt, args);
+        va_end(args);
+        return;
+    }
+
+    Channel& c = channels[channel];
+    size_t offset = c.text.size();
+    char buf[256];
+    va_list again;
+    va_copy(again, args);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    if (len < (int)sizeof(buf)) {
+        c.text.append(buf, len);
+    } else {
+        c.text.resize(offset + len + 1);
+        vsnprintf(&c.text[offset], len + 1, fmt, again);
+        c.text.resize(offset + len);
+    }
+    va_end(again);
+    va_end(args);
+
+    c.lines.push_back({stat_cycles, seq++, (uint32_t)offset, (uint32_t)len});
+    pending_bytes += len;
+    if (pending_bytes >= CONSOLE_BUFFER_BYTES) handoff();
+}
+
+void Console::handoff() {
+    if (pending_bytes == 0) return;
+
+    if (!writer.joinable()) {
+        out = CONSOLE_FILE[0] ? fopen(CONSOLE_FILE, "w") : stdout;
+        if (!out) out = stdout;
+        writer = std::thread(&Console::writer_loop, this);
+    }
+
+    {
+        std::lock_guard<std::mutex> g(lock);
+        queue.push_back(std::move(channels));
+    }
+    work.notify_one();
+    channels = Batch(NUM_CORES + 1);
+    pending_bytes = 0;
+    stat_batches++;
+}
+
+void Console::flush() {
+    handoff();
+    if (!writer.joinable()) return;
+
+    std::unique_lock<std::mutex> g(lock);
+    idle.wait(g, [this] { return queue.empty() && !busy; });
+}
+
+void Console::writer_loop() {
+    std::unique_lock<std::mutex> g(lock);
+    while (true) {
+        work.wait(g, [this] { return stop || !queue.empty(); });
+        if (queue.empty()) break;
+
+        Batch batch = std::move(queue.front());
+        queue.pop_front();
+        busy = true;
+        g.unlock();
+        write_batch(batch);
+        g.lock();
+        busy = false;
+        if (queue.empty()) idle.notify_all();
+    }
+}
+
+void Console::write_batch(const Batch& batch) {
+    // Each channel is already in order; merge them by cycle, then emission
+    std::vector<std::pair<const Line*, const Channel*>> lines;
+    size_t bytes = 0;
+    for (const Channel& c : batch) {
+        for (const Line& l : c.lines) lines.emplace_back(&l, &c);
+        bytes += c.text.size();
+    }
+    std::sort(lines.begin(), lines.end(), [](const auto& a, const auto& b) {
+        if (a.first->cycle != b.first->cycle) return a.first->cycle < b.first->cycle;
+        return a.first->seq < b.first->seq;
+    });
+
+    std::string text;
+    text.reserve(bytes);
+    for (const auto& l : lines) text.append(l.second->text, l.first->offset, l.first->len);
+    fwrite(text.data(), 1, text.size(), out);
+    fflush(out);
+}
@@ -0,0 +1,71 @@
+#ifndef _CONSOLE_H_
+#define _CONSOLE_H_
+
+#include "config.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Simulator console: program output (syscall 11) and DEBUG traces.
+ * With CONSOLE_ASYNC 0, print() is a plain printf. With CONSOLE_ASYNC 1,
+ * each core has its own channel, plus CONSOLE_SYSTEM for uncore output.
+ * Lines are formatted into the channel's buffer and stamped with the base
+ * cycle. Once CONSOLE_BUFFER_BYTES are pending, all channels are handed to
+ * a writer thread in one batch. The writer merges the batch by (cycle,
+ * emission order) and writes it to CONSOLE_FILE (stdout if empty) with one
+ * call. flush() hands off what is pending and waits for the writer; it runs
+ * when a run halts or returns, and at quit. */
+
+#define CONSOLE_SYSTEM NUM_CORES
+
+class Console {
+public:
+    Console();
+    ~Console();
+
+    /* printf on a channel: a core id, or CONSOLE_SYSTEM */
+    void print(int channel, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    /* Writes out everything printed so far */
+    void flush();
+
+    uint64_t stat_lines;   /* print() calls */
+    uint64_t stat_batches; /* Handoffs to the writer */
+
+private:
+    struct Line {
+        uint64_t cycle, seq;
+        uint32_t offset, len;
+    };
+
+    struct Channel {
+        std::string text;
+        std::vector<Line> lines;
+    };
+
+    typedef std::vector<Channel> Batch;
+
+    Batch channels; /* Being filled; simulation thread only */
+    size_t pending_bytes;
+    uint64_t seq;
+
+    std::mutex lock;
+    std::condition_variable work, idle;
+    std::deque<Batch> queue;
+    bool busy, stop;
+    std::thread writer;
+    FILE* out;
+
+    void handoff();
+    void writer_loop();
+    void write_batch(const Batch& batch);
+};
+
+extern Console console;
+
+#endif
@@ -10,16 +10,29 @@
 #include "core.h"
 #include "processor.h"
 #include "shell.h"
+#include "mips.h"
 #include "config.h"
+#include "console.h"
 #include <cstdio>
 #include <cstring>
 
 Core::Core(int id, Processor* p, L2Cache* l2) 
-    : id(id), proc(p), is_running(false),
+    : id(id), is_running(false), proc(p), clock(CORE_FREQ_MHZ),
       icache(id, l2, this, L1_I_SETS, L1_I_ASSOC), 
-      dcache(id, l2, this, L1_D_SETS, L1_D_ASSOC)
+      dcache(id, l2, this, L1_D_SETS, L1_D_ASSOC),
+      functional(ROI_FAST_FORWARD || SMARTS_ENABLE), draining(false),
+      roi_active(false), roi_begin_cycle(0), roi_begin_retire(0),
+      ll_valid(false), ll_addr(0), interval_ready(0), interval_pending(false),
+      interval_pending_fetch(false), interval_pending_write(false), interval_addr(0),
+      interval_fetch_block(~0u), interval_hilo_ready(0),
+      barrier_wait(false), barrier_release(0),
+      stat_inst_retire(0), stat_stall_cycles(0), stat_inst_functional(0),
+      stat_roi_cycles(0), stat_roi_retire(0), stat_sc_success(0), stat_sc_fail(0),
+      stat_barrier_cycles(0), stat_interval_branch_cycles(0), stat_interval_dep_cycles(0)
 {
     pipe = std::make_unique<Pipeline>(this);
+    icache.energy.clock = &clock;
+    dcache.energy.clock = &clock;
     
     /* CPU 0 starts running by default */
     if (id == 0) is_running = true;
@@ -28,28 +41,56 @@ Core::Core(int id, Processor* p, L2Cache* l2)
 void Core::cycle() {
     if (!is_running) return;
 
+    if (barrier_wait) {
+        if (stat_cycles < barrier_release) {
+            stat_barrier_cycles++;
+            return;
+        }
+        barrier_wait = false;
+    }
+
+    if (functional && DBT_ENABLE) {
+        proc->dbt.run(this, ROI_FUNCTIONAL_BATCH);
+        return;
+    }
+    if (functional) {
+        for (int i = 0; i < ROI_FUNCTIONAL_BATCH && is_running && functional && !barrier_wait; i++) {
+            pipe->step_functional();
+        }
+        return;
+    }
+
+    if (INTERVAL_CORE) {
+        interval_cycle();
+        return;
+    }
+
 #ifdef DEBUG
-    printf("\n\n----\n\n[Core %d] PIPELINE:\n", id);
-    printf("DCODE: "); print_op(pipe->decode_op.get());
-    printf("EXEC : "); print_op(pipe->execute_op.get());
-    printf("MEM  : "); print_op(pipe->mem_op.get());
-    printf("WB   : "); print_op(pipe->wb_op.get());
-    printf("\n");
+    console.print(id, "\n\n----\n\n[Core %d] PIPELINE:\n", id);
+    console.print(id, "DCODE: "); print_op(id, pipe->decode_op.get());
+    console.print(id, "EXEC : "); print_op(id, pipe->execute_op.get());
+    console.print(id, "MEM  : "); print_op(id, pipe->mem_op.get());
+    console.print(id, "WB   : "); print_op(id, pipe->wb_op.get());
+    console.print(id, "\n");
 #endif
 
     /* Execute pipeline stages in reverse order to handle stalls/forwarding correctly */
+    pipe->cache_stall = false;
     pipe->wb();
     pipe->mem();
     pipe->execute();
     pipe->decode();
         
-    if (is_running)
+    if (is_running && !draining)
         pipe->fetch();
 
+    if (pipe->cache_stall)
+        stat_stall_cycles++;
+
     /* handle branch recoveries */
     if (pipe->branch_recover) {
 #ifdef DEBUG
-        printf("[Core %d] branch recovery: new dest %08x flush %d stages\n", id, pipe->branch_dest, pipe->branch_flush);
+        console.print(id, "[Core %d] branch recovery: new dest %08x flush %d stages\n", id, pipe->branch_dest, pipe->branch_flush);
 #endif
 
         pipe->PC = pipe->branch_dest;
@@ -76,6 +117,168 @@ void Core::cycle() {
 
         stat_squash++;
     }
+
+    if (draining && pipe->empty()) {
+        draining = false;
+        functional = true;
+    }
+}
+
+void Core::set_functional(bool on) {
+    if (!on) {
+        functional = draining = false;
+    } else if (INTERVAL_CORE) {
+        // Nothing in flight but the pending miss, which the L1 completes on its own
+        functional = true;
+        interval_pending = false;
+        interval_ready = 0;
+        interval_fetch_block = ~0u;
+    } else if (!functional) {
+        if (pipe->empty()) functional = true;
+        else draining = true;
+    }
+}
+
+void Core::interval_cycle() {
+    if (clock.cycles < interval_ready) return;
+
+    /* Outstanding miss: issue it at its time, then wait for the L1 */
+    if (interval_pending) {
+        L1Cache& l1 = interval_pending_fetch ? icache : dcache;
+        if (!l1.access(interval_addr, interval_pending_write, !interval_pending_fetch, pipe->PC)) {
+            stat_stall_cycles++;
+            return;
+        }
+        interval_pending = false;
+        if (interval_pending_fetch) interval_fetch_block = interval_addr & ~(BLOCK_SIZE - 1);
+    }
+
+    /* Cycles charged to the batch so far. Hits are taken at once; a miss ends
+     * the batch and is issued once the charged cycles have elapsed. */
+    uint64_t t = 0;
+    for (int i = 0; i < INTERVAL_BATCH && is_running && !functional && !barrier_wait; i++) {
+        uint32_t fetch = translate(pipe->PC);
+        if ((fetch & ~(BLOCK_SIZE - 1)) != interval_fetch_block) {
+            if (!icache.would_hit(fetch, false)) {
+                interval_pending = interval_pending_fetch = true;
+                interval_pending_write = false;
+                interval_addr = fetch;
+                break;
+            }
+            icache.access(fetch, false, false, pipe->PC);
+            interval_fetch_block = fetch & ~(BLOCK_SIZE - 1);
+        }
+
+        Pipe_Op op;
+        pipe->step_functional(&op);
+        t++;
+
+        /* Dependences the pipeline would stall on. A load's result needs
+         * none: MEM runs before EX in a cycle, so it is bypassed from WB. */
+        uint64_t issue = clock.cycles + t;
+
+        if (op.opcode == OP_SPECIAL) {
+            switch (op.subop) {
+                case SUBOP_MULT:
+                case SUBOP_MULTU:
+                    interval_hilo_ready = issue + 4; // As the pipeline's multiplier
+                    break;
+                case SUBOP_DIV:
+                case SUBOP_DIVU:
+                    interval_hilo_ready = issue + 32;
+                    break;
+                case SUBOP_MFHI:
+                case SUBOP_MFLO:
+                case SUBOP_MTHI:
+                case SUBOP_MTLO:
+                    if (issue < interval_hilo_ready) {
+                        t += interval_hilo_ready - issue;
+                        stat_interval_dep_cycles += interval_hilo_ready - issue;
+                    }
+                    break;
+                case SUBOP_SYSCALL:
+                    t += INTERVAL_SERIALIZE_PENALTY;
+                    stat_interval_dep_cycles += INTERVAL_SERIALIZE_PENALTY;
+                    break;
+            }
+        }
+
+        /* Taken branches squash the fall-through fetches */
+        if (op.branch_taken) {
+            t += INTERVAL_BRANCH_PENALTY;
+            stat_interval_branch_cycles += INTERVAL_BRANCH_PENALTY;
+        }
+
+        /* Data access; a failed SC makes none */
+        bool failed_sc = op.opcode == OP_SC && op.reg_dst_value == 0;
+        if (op.is_mem && !failed_sc) {
+            uint32_t addr = translate(op.mem_addr);
+            if (FALSE_SHARING_DETECT) proc->sharing.access(id, addr, op.mem_write);
+            if (RD_PROFILE) proc->reuse.access_l1d(id, addr);
+            if (!dcache.would_hit(addr, op.mem_write)) {
+                interval_pending = true;
+                interval_pending_fetch = false;
+                interval_pending_write = op.mem_write;
+                interval_addr = addr;
+
+                /* Overlap: the next block's fetch miss starts under this one */
+                uint32_t next = translate(pipe->PC);
+                if ((next & ~(BLOCK_SIZE - 1)) != interval_fetch_block && !icache.would_hit(next, false))
+                    icache.access(next, false, false, pipe->PC);
+                break;
+            }
+            dcache.access(addr, op.mem_write, true, op.pc);
+        }
+
+        /* Synchronization ends the batch, so other cores interleave at the right time */
+        if (op.opcode == OP_LL || op.opcode == OP_SC || (op.opcode == OP_SPECIAL && op.subop == SUBOP_SYSCALL))
+            break;
+    }
+
+    interval_ready = clock.cycles + t;
+
+    /* A miss found before any cycle was charged is issued right away */
+    if (interval_pending && t == 0) interval_cycle();
+}
+
+uint32_t Core::translate(uint32_t vaddr) {
+    return proc->page_alloc.translate(vaddr, id);
+}
+
+void Core::warm(uint32_t vaddr, bool is_write, bool is_fetch) {
+    (is_fetch ? icache : dcache).warm(translate(vaddr), is_write);
+}
+
+void Core::set_link(uint32_t paddr) {
+    ll_valid = true;
+    ll_addr = paddr & ~(BLOCK_SIZE - 1);
+}
+
+bool Core::has_link(uint32_t paddr) const {
+    return ll_valid && ll_addr == (paddr & ~(BLOCK_SIZE - 1));
+}
+
+void Core::clear_link(uint32_t paddr) {
+    if (has_link(paddr)) {
+#ifdef DEBUG
+        console.print(id, "[Core %d] LL link on %08x broken\n", id, ll_addr);
+#endif
+        ll_valid = false;
+    }
+}
+
+uint64_t Core::read_perf_counter(int counter) {
+    switch (counter) {
+        case PERF_CYCLES:       return clock.cycles;
+        case PERF_INSTRET:      return stat_inst_retire;
+        case PERF_L1I_MISSES:   return icache.stat_misses;
+        case PERF_L1D_MISSES:   return dcache.stat_misses;
+        case PERF_L2_MISSES:    return proc->l2_of(id)->stat_misses[id];
+        case PERF_DRAM_REQS:    return proc->dram.stat_requests[id];
+        case PERF_STALL_CYCLES: return stat_stall_cycles;
+        case PERF_BASE_CYCLES:  return stat_cycles;
+        default:                return 0;
+    }
 }
 
 void Core::handle_syscall(Pipe_Op* op) {
@@ -86,10 +289,32 @@ void Core::handle_syscall(Pipe_Op* op) {
         /* Syscall 10: Halt current CPU */
         pipe->PC = op->pc + 4; /* fetch will do pc += 4, then we stop with correct PC */
         is_running = false;
+        proc->barrier_open();
     }
     else if (v0 == 0xB) {
         /* Syscall 11: Print output */
-        printf("OUT (CPU %d): %08x\n", id, v1);
+        console.print(id, "OUT (CPU %d): %08x\n", id, v1);
+    }
+    else if (v0 == 0x20) {
+        /* Syscall 0x20: DVFS, set this core's frequency to $v1 MHz */
+        clock.set_freq(v1);
+    }
+    else if (v0 == 0x30) {
+        /* Syscall 0x30: read performance counter $v1 into $v1 ($v1 | 0x100 = upper word) */
+        uint64_t value = read_perf_counter(v1 & 0xFF);
+        pipe->REGS[3] = (v1 & 0x100) ? (uint32_t)(value >> 32) : (uint32_t)value;
+    }
+    else if (v0 == 0x50) {
+        /* Syscall 0x50: barrier across $v1 cores (0 = all running cores) */
+        proc->barrier_arrive(this, v1);
+    }
+    else if (v0 == 0x40) {
+        /* Syscall 0x40: begin region of interest */
+        proc->roi_begin(this);
+    }
+    else if (v0 == 0x41) {
+        /* Syscall 0x41: end region of interest */
+        proc->roi_end(this);
     }
     else if (v0 >= 1 && v0 <= 3) {
         /* Syscall 1, 2, 3: Spawn thread on CPU $v0 */
@@ -100,12 +325,14 @@ void Core::handle_syscall(Pipe_Op* op) {
              
              if (!target->is_running) {
 #ifdef DEBUG
-                  printf("Spawning thread on Core %d from Core %d\n", target_id, id);
+                  console.print(id, "Spawning thread on Core %d from Core %d\n", target_id, id);
 #endif
                   target->pipe->PC = op->pc + 4;
                   target->pipe->REGS[3] = 1; /* $v1 = 1 for child */
                   target->is_running = true;
+                  if (ROI_FAST_FORWARD) target->set_functional(!proc->in_roi(target));
                   pipe->REGS[3] = 0; /* $v1 = 0 for parent */
+                  proc->barrier_open();
              }
         }
     }
@@ -11,11 +11,24 @@
 
 #include "pipe.h"
 #include "cache.h"
+#include "clock.h"
 #include <memory>
 #include <vector>
 
 class Processor;
 
+/* Counters readable by guest code through syscall 0x30 */
+enum PerfCounter {
+    PERF_CYCLES = 0,       /* Core clock cycles */
+    PERF_INSTRET = 1,      /* Instructions retired by this core */
+    PERF_L1I_MISSES = 2,
+    PERF_L1D_MISSES = 3,
+    PERF_L2_MISSES = 4,    /* L2 misses caused by this core */
+    PERF_DRAM_REQS = 5,    /* DRAM requests issued for this core */
+    PERF_STALL_CYCLES = 6, /* Core cycles with fetch or mem waiting on an L1 miss */
+    PERF_BASE_CYCLES = 7   /* Global base-clock cycles */
+};
+
 class Core {
 public:
     Core(int id, Processor* p, L2Cache* l2);
@@ -24,14 +37,69 @@ public:
     bool is_running;
     Processor* proc;
     std::unique_ptr<Pipeline> pipe;
+
+    /* Core clock domain (DVFS-controlled) */
+    ClockDomain clock;
     
     /* Private Caches */
     L1Cache icache;
     L1Cache dcache;
 
-    /* Ticks the core logic (pipeline) */
+    /* Ticks the core logic (pipeline, or interval model) */
     void cycle();
 
+    /* Functional cache warming for one access (FUNCTIONAL_WARM / SMARTS) */
+    void warm(uint32_t vaddr, bool is_write, bool is_fetch);
+
+    /* Translates a virtual address to the physical address seen by the caches */
+    uint32_t translate(uint32_t vaddr);
+
+    /* Simulation mode: functional cores run step_functional() instead of
+     * the pipeline. A core leaving timing mode first drains its pipeline. */
+    bool functional;
+    bool draining;
+    void set_functional(bool on);
+
+    /* Per-core ROI (ROI_PER_CORE) */
+    bool roi_active;
+    uint64_t roi_begin_cycle, roi_begin_retire;
+
+    /* LL/SC link register: physical block of the last LL. Broken by a
+     * write-invalidate snoop or eviction of that block, or by a successful SC. */
+    bool ll_valid;
+    uint32_t ll_addr;
+    void set_link(uint32_t paddr);
+    bool has_link(uint32_t paddr) const;
+    void clear_link(uint32_t paddr);
+
+    /* Interval model (INTERVAL_CORE): instructions run functionally in
+     * batches; the core then sleeps for the cycles they were charged, or
+     * until the L1 completes the miss that ended the batch. */
+    uint64_t interval_ready;       /* Core cycle the next batch may start */
+    bool interval_pending;         /* L1 access to issue at interval_ready and wait for */
+    bool interval_pending_fetch;
+    bool interval_pending_write;
+    uint32_t interval_addr;        /* Physical address of the pending access */
+    uint32_t interval_fetch_block; /* Last block fetched: one I-cache access per block */
+    uint64_t interval_hilo_ready;  /* Core cycle HI/LO are written by a multiply/divide */
+    void interval_cycle();
+
+    /* Hardware barrier (syscall 0x50): the core stalls until released */
+    bool barrier_wait;
+    uint64_t barrier_release; /* Base cycle of release, UINT64_MAX until all arrive */
+
+    /* Statistics */
+    uint64_t stat_inst_retire;
+    uint64_t stat_stall_cycles;
+    uint64_t stat_inst_functional;
+    uint64_t stat_roi_cycles, stat_roi_retire;
+    uint64_t stat_sc_success, stat_sc_fail;
+    uint64_t stat_barrier_cycles;
+    uint64_t stat_interval_branch_cycles, stat_interval_dep_cycles;
+
+    /* Returns a performance counter (0 for unknown ids) */
+    uint64_t read_perf_counter(int counter);
+
     /* Handles system calls forwarded from the pipeline WB stage */
     void handle_syscall(Pipe_Op* op);
 };
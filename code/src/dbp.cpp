@@ -0,0 +1,89 @@
+#include "dbp.h"
+
+DeadBlockPredictor::DeadBlockPredictor(uint32_t l2_sets)
+    : stat_sampler_hits(0), stat_sampler_evictions(0), stat_dead_victims(0), stat_bypasses(0), stat_false_dead(0)
+{
+    sample_stride = l2_sets / DBP_SAMPLER_SETS;
+    if (sample_stride == 0) sample_stride = 1;
+
+    sampler.resize(DBP_SAMPLER_SETS * DBP_SAMPLER_ASSOC);
+    for (auto& e : sampler) {
+        e.valid = false;
+        e.tag = 0;
+        e.signature = 0;
+        e.lru = 0;
+    }
+    for (int t = 0; t < DBP_TABLES; t++) {
+        tables[t].assign(DBP_TABLE_SIZE, 0);
+    }
+}
+
+uint32_t DeadBlockPredictor::table_index(int t, uint16_t sig) const {
+    // Skewed hashes so signatures that alias in one table rarely alias in all
+    uint32_t h = sig ^ (sig >> (t + 3)) ^ ((uint32_t)sig * (2 * t + 1) << t);
+    return h % DBP_TABLE_SIZE;
+}
+
+bool DeadBlockPredictor::predict(uint32_t pc) const {
+    uint16_t sig = signature(pc);
+    int sum = 0;
+    for (int t = 0; t < DBP_TABLES; t++) {
+        sum += tables[t][table_index(t, sig)];
+    }
+    return sum >= DBP_THRESHOLD;
+}
+
+void DeadBlockPredictor::train(uint16_t sig, bool dead) {
+    const uint8_t max = (1 << DBP_COUNTER_BITS) - 1;
+    for (int t = 0; t < DBP_TABLES; t++) {
+        uint8_t& c = tables[t][table_index(t, sig)];
+        if (dead) {
+            if (c < max) c++;
+        } else {
+            if (c > 0) c--;
+        }
+    }
+}
+
+void DeadBlockPredictor::access(uint32_t set_idx, uint32_t tag, uint32_t pc) {
+    if (set_idx % sample_stride != 0) return;
+    uint32_t s = set_idx / sample_stride;
+    if (s >= DBP_SAMPLER_SETS) return;
+
+    SamplerEntry* set = &sampler[s * DBP_SAMPLER_ASSOC];
+    uint16_t ptag = tag & 0x7FFF;
+
+    int way = -1;
+    for (int i = 0; i < DBP_SAMPLER_ASSOC; i++) {
+        if (set[i].valid && set[i].tag == ptag) { way = i; break; }
+    }
+
+    if (way != -1) {
+        // Re-referenced: the previous touch was not the last one
+        train(set[way].signature, false);
+        stat_sampler_hits++;
+    } else {
+        // Invalid way first, else LRU
+        way = 0;
+        for (int i = 0; i < DBP_SAMPLER_ASSOC; i++) {
+            if (!set[i].valid) { way = i; break; }
+            if (set[i].lru > set[way].lru) way = i;
+        }
+        if (set[way].valid) {
+            // Evicted without reuse: its last touch led to a dead line
+            train(set[way].signature, true);
+            stat_sampler_evictions++;
+        }
+        set[way].valid = true;
+        set[way].tag = ptag;
+        set[way].lru = DBP_SAMPLER_ASSOC - 1; // Promoted to MRU below
+    }
+    set[way].signature = signature(pc);
+
+    // Promote to MRU
+    uint8_t old = set[way].lru;
+    for (int i = 0; i < DBP_SAMPLER_ASSOC; i++) {
+        if (set[i].valid && set[i].lru < old) set[i].lru++;
+    }
+    set[way].lru = 0;
+}
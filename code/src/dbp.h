@@ -0,0 +1,50 @@
+#ifndef _DBP_H_
+#define _DBP_H_
+
+#include "config.h"
+#include <cstdint>
+#include <vector>
+
+/* Sampling dead-block predictor (L2).
+ * A small LRU tag array shadows DBP_SAMPLER_SETS of the L2 sets and records
+ * the PC signature of each line's last touch. A line re-referenced in the
+ * sampler trains its old signature towards "live"; a line evicted from the
+ * sampler trains its signature towards "dead". Predictions sum one saturating
+ * counter from each of DBP_TABLES skewed tables, indexed by the PC of the
+ * current access. */
+
+class DeadBlockPredictor {
+public:
+    DeadBlockPredictor(uint32_t l2_sets);
+
+    /* True if a line last touched by pc is predicted dead */
+    bool predict(uint32_t pc) const;
+
+    /* Trains on a demand access; ignored for sets that are not sampled */
+    void access(uint32_t set_idx, uint32_t tag, uint32_t pc);
+
+    /* Statistics */
+    uint64_t stat_sampler_hits;
+    uint64_t stat_sampler_evictions;
+    uint64_t stat_dead_victims;  /* Replacements that picked a predicted-dead line */
+    uint64_t stat_bypasses;      /* Fills that skipped L2 allocation */
+    uint64_t stat_false_dead;    /* Hits on lines predicted dead */
+
+private:
+    struct SamplerEntry {
+        bool valid;
+        uint16_t tag;       /* Partial tag */
+        uint16_t signature; /* PC signature of the last touch */
+        uint8_t lru;
+    };
+
+    uint32_t sample_stride; /* One sampled set every sample_stride L2 sets */
+    std::vector<SamplerEntry> sampler; /* DBP_SAMPLER_SETS x DBP_SAMPLER_ASSOC */
+    std::vector<uint8_t> tables[DBP_TABLES];
+
+    static uint16_t signature(uint32_t pc) { return (pc >> 2) & 0x7FFF; }
+    uint32_t table_index(int t, uint16_t sig) const;
+    void train(uint16_t sig, bool dead);
+};
+
+#endif
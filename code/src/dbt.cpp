@@ -0,0 +1,377 @@
+#include "dbt.h"
+#include "processor.h"
+#include "mips.h"
+#include "shell.h"
+#include "console.h"
+#include <cstdio>
+
+#define REG(r) (c.pipe->REGS[r])
+
+/* Handlers. Each mirrors the pipeline semantics in Pipeline::alu and
+ * Pipeline::mem_data; writes to R0 are dropped at translation time, except
+ * for loads, which still touch memory. */
+
+static void h_sll(DbtContext& c, const DbtInsn& in)  { REG(in.rd) = REG(in.rt) << in.shamt; }
+static void h_srl(DbtContext& c, const DbtInsn& in)  { REG(in.rd) = REG(in.rt) >> in.shamt; }
+static void h_sra(DbtContext& c, const DbtInsn& in)  { REG(in.rd) = (int32_t)REG(in.rt) >> in.shamt; }
+static void h_sllv(DbtContext& c, const DbtInsn& in) { REG(in.rd) = REG(in.rt) << REG(in.rs); }
+static void h_srlv(DbtContext& c, const DbtInsn& in) { REG(in.rd) = REG(in.rt) >> REG(in.rs); }
+static void h_srav(DbtContext& c, const DbtInsn& in) { REG(in.rd) = (int32_t)REG(in.rt) >> REG(in.rs); }
+static void h_addu(DbtContext& c, const DbtInsn& in) { REG(in.rd) = REG(in.rs) + REG(in.rt); }
+static void h_subu(DbtContext& c, const DbtInsn& in) { REG(in.rd) = REG(in.rs) - REG(in.rt); }
+static void h_and(DbtContext& c, const DbtInsn& in)  { REG(in.rd) = REG(in.rs) & REG(in.rt); }
+static void h_or(DbtContext& c, const DbtInsn& in)   { REG(in.rd) = REG(in.rs) | REG(in.rt); }
+static void h_xor(DbtContext& c, const DbtInsn& in)  { REG(in.rd) = REG(in.rs) ^ REG(in.rt); }
+static void h_nor(DbtContext& c, const DbtInsn& in)  { REG(in.rd) = ~(REG(in.rs) | REG(in.rt)); }
+static void h_slt(DbtContext& c, const DbtInsn& in)  { REG(in.rd) = ((int32_t)REG(in.rs) < (int32_t)REG(in.rt)) ? 1 : 0; }
+static void h_sltu(DbtContext& c, const DbtInsn& in) { REG(in.rd) = (REG(in.rs) < REG(in.rt)) ? 1 : 0; }
+static void h_mfhi(DbtContext& c, const DbtInsn& in) { REG(in.rd) = c.pipe->HI; }
+static void h_mflo(DbtContext& c, const DbtInsn& in) { REG(in.rd) = c.pipe->LO; }
+static void h_mthi(DbtContext& c, const DbtInsn& in) { c.pipe->HI = REG(in.rs); }
+static void h_mtlo(DbtContext& c, const DbtInsn& in) { c.pipe->LO = REG(in.rs); }
+
+static void h_mult(DbtContext& c, const DbtInsn& in) {
+    uint64_t val = (uint64_t)((int64_t)(int32_t)REG(in.rs) * (int64_t)(int32_t)REG(in.rt));
+    c.pipe->HI = (uint32_t)(val >> 32);
+    c.pipe->LO = (uint32_t)val;
+}
+
+static void h_multu(DbtContext& c, const DbtInsn& in) {
+    uint64_t val = (uint64_t)REG(in.rs) * (uint64_t)REG(in.rt);
+    c.pipe->HI = (uint32_t)(val >> 32);
+    c.pipe->LO = (uint32_t)val;
+}
+
+static void h_div(DbtContext& c, const DbtInsn& in) {
+    int32_t val1 = (int32_t)REG(in.rs), val2 = (int32_t)REG(in.rt);
+    if (val2 != 0) {
+        c.pipe->LO = val1 / val2;
+        c.pipe->HI = val1 % val2;
+    } else {
+        c.pipe->HI = c.pipe->LO = 0;
+    }
+}
+
+static void h_divu(DbtContext& c, const DbtInsn& in) {
+    uint32_t val1 = REG(in.rs), val2 = REG(in.rt);
+    if (val2 != 0) {
+        c.pipe->HI = val1 % val2;
+        c.pipe->LO = val1 / val2;
+    } else {
+        c.pipe->HI = c.pipe->LO = 0;
+    }
+}
+
+static void h_addiu(DbtContext& c, const DbtInsn& in) { REG(in.rt) = REG(in.rs) + in.imm; }
+static void h_slti(DbtContext& c, const DbtInsn& in)  { REG(in.rt) = (int32_t)REG(in.rs) < (int32_t)in.imm ? 1 : 0; }
+static void h_sltiu(DbtContext& c, const DbtInsn& in) { REG(in.rt) = REG(in.rs) < in.imm ? 1 : 0; }
+static void h_andi(DbtContext& c, const DbtInsn& in)  { REG(in.rt) = REG(in.rs) & in.imm; }
+static void h_ori(DbtContext& c, const DbtInsn& in)   { REG(in.rt) = REG(in.rs) | in.imm; }
+static void h_xori(DbtContext& c, const DbtInsn& in)  { REG(in.rt) = REG(in.rs) ^ in.imm; }
+static void h_lui(DbtContext& c, const DbtInsn& in)   { REG(in.rt) = in.imm; }
+
+/* Branches set the next PC; links are written after the sources are read */
+static void h_jr(DbtContext& c, const DbtInsn& in) {
+    uint32_t dest = REG(in.rs);
+    if (in.rd) REG(in.rd) = in.pc + 4;
+    c.pipe->PC = dest;
+}
+static void h_j(DbtContext& c, const DbtInsn& in)   { c.pipe->PC = in.target; }
+static void h_jal(DbtContext& c, const DbtInsn& in) { REG(31) = in.pc + 4; c.pipe->PC = in.target; }
+static void h_beq(DbtContext& c, const DbtInsn& in) { c.pipe->PC = REG(in.rs) == REG(in.rt) ? in.target : in.pc + 4; }
+static void h_bne(DbtContext& c, const DbtInsn& in) { c.pipe->PC = REG(in.rs) != REG(in.rt) ? in.target : in.pc + 4; }
+static void h_blez(DbtContext& c, const DbtInsn& in) { c.pipe->PC = (int32_t)REG(in.rs) <= 0 ? in.target : in.pc + 4; }
+static void h_bgtz(DbtContext& c, const DbtInsn& in) { c.pipe->PC = (int32_t)REG(in.rs) > 0 ? in.target : in.pc + 4; }
+static void h_bltz(DbtContext& c, const DbtInsn& in) { c.pipe->PC = (int32_t)REG(in.rs) < 0 ? in.target : in.pc + 4; }
+static void h_bgez(DbtContext& c, const DbtInsn& in) { c.pipe->PC = (int32_t)REG(in.rs) >= 0 ? in.target : in.pc + 4; }
+static void h_bltzal(DbtContext& c, const DbtInsn& in) { h_bltz(c, in); REG(31) = in.pc + 4; }
+static void h_bgezal(DbtContext& c, const DbtInsn& in) { h_bgez(c, in); REG(31) = in.pc + 4; }
+
+/* Memory */
+static uint32_t load_word(DbtContext& c, uint32_t addr) {
+    if (c.dbt->warm) c.dbt->warm(c.core, addr, false, false);
+    return mem_read_32(addr & ~3);
+}
+
+static void store_word(DbtContext& c, uint32_t addr, uint32_t val) {
+    if (c.dbt->warm) c.dbt->warm(c.core, addr, true, false);
+    mem_write_32(addr & ~3, val);
+    c.dbt->note_store(addr);
+    c.core->proc->clear_links(c.core->translate(addr), c.core);
+}
+
+static void h_lw(DbtContext& c, const DbtInsn& in) {
+    uint32_t val = load_word(c, REG(in.rs) + in.imm);
+    if (in.rt) REG(in.rt) = val;
+}
+
+static void h_lh(DbtContext& c, const DbtInsn& in) {
+    uint32_t addr = REG(in.rs) + in.imm;
+    uint32_t val = load_word(c, addr);
+    val = (addr & 2) ? (val >> 16) & 0xFFFF : val & 0xFFFF;
+    if (in.rt) REG(in.rt) = val | ((val & 0x8000) ? 0xFFFF8000 : 0);
+}
+
+static void h_lhu(DbtContext& c, const DbtInsn& in) {
+    uint32_t addr = REG(in.rs) + in.imm;
+    uint32_t val = load_word(c, addr);
+    if (in.rt) REG(in.rt) = (addr & 2) ? (val >> 16) & 0xFFFF : val & 0xFFFF;
+}
+
+static void h_lb(DbtContext& c, const DbtInsn& in) {
+    uint32_t addr = REG(in.rs) + in.imm;
+    uint32_t val = (load_word(c, addr) >> ((addr & 3) * 8)) & 0xFF;
+    if (in.rt) REG(in.rt) = val | ((val & 0x80) ? 0xFFFFFF80 : 0);
+}
+
+static void h_lbu(DbtContext& c, const DbtInsn& in) {
+    uint32_t addr = REG(in.rs) + in.imm;
+    uint32_t val = (load_word(c, addr) >> ((addr & 3) * 8)) & 0xFF;
+    if (in.rt) REG(in.rt) = val;
+}
+
+static void h_sw(DbtContext& c, const DbtInsn& in) {
+    store_word(c, REG(in.rs) + in.imm, REG(in.rt));
+}
+
+static void h_sh(DbtContext& c, const DbtInsn& in) {
+    uint32_t addr = REG(in.rs) + in.imm;
+    uint32_t val = mem_read_32(addr & ~3);
+    if (addr & 2)
+        val = (val & 0x0000FFFF) | (REG(in.rt) << 16);
+    else
+        val = (val & 0xFFFF0000) | (REG(in.rt) & 0xFFFF);
+    store_word(c, addr, val);
+}
+
+static void h_sb(DbtContext& c, const DbtInsn& in) {
+    uint32_t addr = REG(in.rs) + in.imm;
+    int shift = (addr & 3) * 8;
+    uint32_t val = mem_read_32(addr & ~3);
+    val = (val & ~(0xFFu << shift)) | ((REG(in.rt) & 0xFF) << shift);
+    store_word(c, addr, val);
+}
+
+/* Handler for an instruction, or nullptr to leave it to the interpreter.
+ * Sets *nop for instructions with no architectural effect (writes to R0). */
+static DbtHandler select_handler(const Pipe_Op& op, const DbtInsn& in, bool* nop) {
+    *nop = false;
+    switch (op.opcode) {
+        case OP_SPECIAL: {
+            DbtHandler fn = nullptr;
+            switch (op.subop) {
+                case SUBOP_SLL:  fn = h_sll; break;
+                case SUBOP_SRL:  fn = h_srl; break;
+                case SUBOP_SRA:  fn = h_sra; break;
+                case SUBOP_SLLV: fn = h_sllv; break;
+                case SUBOP_SRLV: fn = h_srlv; break;
+                case SUBOP_SRAV: fn = h_srav; break;
+                case SUBOP_ADD:
+                case SUBOP_ADDU: fn = h_addu; break;
+                case SUBOP_SUB:
+                case SUBOP_SUBU: fn = h_subu; break;
+                case SUBOP_AND:  fn = h_and; break;
+                case SUBOP_OR:   fn = h_or; break;
+                case SUBOP_XOR:  fn = h_xor; break;
+                case SUBOP_NOR:  fn = h_nor; break;
+                case SUBOP_SLT:  fn = h_slt; break;
+                case SUBOP_SLTU: fn = h_sltu; break;
+                case SUBOP_MFHI: fn = h_mfhi; break;
+                case SUBOP_MFLO: fn = h_mflo; break;
+                case SUBOP_MTHI:  return h_mthi;
+                case SUBOP_MTLO:  return h_mtlo;
+                case SUBOP_MULT:  return h_mult;
+                case SUBOP_MULTU: return h_multu;
+                case SUBOP_DIV:   return h_div;
+                case SUBOP_DIVU:  return h_divu;
+                case SUBOP_JR:
+                case SUBOP_JALR:  return h_jr;
+                default:          return nullptr;
+            }
+            *nop = (in.rd == 0);
+            return fn;
+        }
+
+        case OP_BRSPEC:
+            switch (op.subop) {
+                case BROP_BLTZ:   return h_bltz;
+                case BROP_BGEZ:   return h_bgez;
+                case BROP_BLTZAL: return h_bltzal;
+                case BROP_BGEZAL: return h_bgezal;
+                default:          return nullptr;
+            }
+
+        case OP_J:    return h_j;
+        case OP_JAL:  return h_jal;
+        case OP_BEQ:  return h_beq;
+        case OP_BNE:  return h_bne;
+        case OP_BLEZ: return h_blez;
+        case OP_BGTZ: return h_bgtz;
+
+        case OP_ADDI:
+        case OP_ADDIU: *nop = (in.rt == 0); return h_addiu;
+        case OP_SLTI:  *nop = (in.rt == 0); return h_slti;
+        case OP_SLTIU: *nop = (in.rt == 0); return h_sltiu;
+        case OP_ANDI:  *nop = (in.rt == 0); return h_andi;
+        case OP_ORI:   *nop = (in.rt == 0); return h_ori;
+        case OP_XORI:  *nop = (in.rt == 0); return h_xori;
+        case OP_LUI:   *nop = (in.rt == 0); return h_lui;
+
+        case OP_LW:  return h_lw;
+        case OP_LH:  return h_lh;
+        case OP_LHU: return h_lhu;
+        case OP_LB:  return h_lb;
+        case OP_LBU: return h_lbu;
+        case OP_SW:  return h_sw;
+        case OP_SH:  return h_sh;
+        case OP_SB:  return h_sb;
+
+        default:     return nullptr; /* syscall-free ops only; ll/sc stay interpreted */
+    }
+}
+
+BlockTranslator::BlockTranslator()
+    : warm(nullptr), stat_blocks(0), stat_block_execs(0), stat_insts(0), stat_chained(0),
+      stat_invalidations(0), text_pages(1u << 20, false)
+{
+}
+
+DbtBlock* BlockTranslator::translate(uint32_t pc) {
+    auto b = std::make_unique<DbtBlock>();
+    b->start = pc;
+    b->ends_in_branch = false;
+    b->chain[0] = b->chain[1] = nullptr;
+
+    uint32_t cur = pc;
+    while ((cur - pc) / 4 < DBT_MAX_BLOCK) {
+        Pipe_Op op;
+        op.instruction = mem_read_32(cur);
+        op.pc = cur;
+        Pipeline::decode_fields(&op);
+
+        DbtInsn in;
+        in.pc = cur;
+        in.rs = (op.instruction >> 21) & 0x1F;
+        in.rt = (op.instruction >> 16) & 0x1F;
+        in.rd = (op.instruction >> 11) & 0x1F;
+        in.shamt = op.shamt;
+        in.imm = (op.opcode == OP_ANDI || op.opcode == OP_ORI || op.opcode == OP_XORI) ? op.imm16 :
+                 (op.opcode == OP_LUI) ? op.imm16 << 16 : op.se_imm16;
+        in.target = op.branch_dest;
+
+        bool nop;
+        in.fn = select_handler(op, in, &nop);
+        if (!in.fn) break;
+        if (!nop) b->insns.push_back(in);
+
+        cur += 4;
+        if (op.is_branch) {
+            b->ends_in_branch = true;
+            break;
+        }
+    }
+    b->end = cur;
+
+    for (uint32_t line = pc & ~(BLOCK_SIZE - 1); line < cur; line += BLOCK_SIZE) {
+        b->lines.push_back(line);
+    }
+    uint32_t last = (cur > pc) ? cur - 4 : pc;
+    for (uint32_t page = pc >> 12; page <= (last >> 12); page++) {
+        text_pages[page] = true;
+    }
+
+#ifdef DEBUG
+    console.print(CONSOLE_SYSTEM, "[DBT] Block %08x-%08x: %zu handlers\n", b->start, b->end, b->insns.size());
+#endif
+
+    stat_blocks++;
+    DbtBlock* raw = b.get();
+    blocks[pc] = std::move(b);
+    return raw;
+}
+
+void BlockTranslator::flush_pending() {
+    for (uint32_t page : pending_pages) {
+        if (!text_pages[page]) continue;
+        text_pages[page] = false;
+        for (auto it = blocks.begin(); it != blocks.end();) {
+            const DbtBlock& b = *it->second;
+            uint32_t last = (b.end > b.start) ? b.end - 4 : b.start;
+            if ((b.start >> 12) <= page && page <= (last >> 12)) {
+                it = blocks.erase(it);
+                stat_invalidations++;
+            } else {
+                ++it;
+            }
+        }
+    }
+    pending_pages.clear();
+
+    /* Surviving blocks may chain to dropped ones */
+    for (auto& kv : blocks) {
+        kv.second->chain[0] = kv.second->chain[1] = nullptr;
+    }
+}
+
+void BlockTranslator::interpret_block(Core* core, int& budget) {
+    Pipeline* p = core->pipe.get();
+    while (budget > 0 && core->is_running && core->functional && !core->barrier_wait) {
+        Pipe_Op op;
+        op.instruction = mem_read_32(p->PC);
+        op.pc = p->PC;
+        Pipeline::decode_fields(&op);
+
+        p->step_functional();
+        budget--;
+
+        if (op.is_branch || (op.opcode == OP_SPECIAL && op.subop == SUBOP_SYSCALL)) break;
+    }
+}
+
+void BlockTranslator::run(Core* core, int budget) {
+    Pipeline* p = core->pipe.get();
+    DbtContext c{p, core, this};
+    DbtBlock* prev = nullptr;
+
+    while (budget > 0 && core->is_running && core->functional && !core->barrier_wait) {
+        if (!pending_pages.empty()) {
+            flush_pending();
+            prev = nullptr;
+        }
+
+        uint32_t pc = p->PC;
+        DbtBlock* b = nullptr;
+        if (prev && prev->chain[0] && prev->chain[0]->start == pc) b = prev->chain[0];
+        else if (prev && prev->chain[1] && prev->chain[1]->start == pc) b = prev->chain[1];
+
+        if (b) {
+            stat_chained++;
+        } else {
+            auto it = blocks.find(pc);
+            if (it != blocks.end()) b = it->second.get();
+            else if (++entries[pc] >= DBT_HOT_THRESHOLD) b = translate(pc);
+            if (b && prev) prev->chain[pc == prev->end ? 1 : 0] = b;
+        }
+
+        if (!b || b->end == b->start) {
+            interpret_block(core, budget);
+            prev = nullptr;
+            continue;
+        }
+
+        if (warm) {
+            for (uint32_t line : b->lines) warm(core, line, false, true);
+        }
+        for (const DbtInsn& in : b->insns) {
+            in.fn(c, in);
+        }
+        if (!b->ends_in_branch) p->PC = b->end;
+
+        uint32_t n = (b->end - b->start) / 4;
+        budget -= n;
+        core->stat_inst_functional += n;
+        stat_insts += n;
+        stat_block_execs++;
+        prev = b;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef _DBT_H_
+#define _DBT_H_
+
+#include "config.h"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/* Dynamic binary translation for the functional (fast-forward) path.
+ * Block entries are counted while interpreting with step_functional(); a
+ * start PC entered DBT_HOT_THRESHOLD times is translated into a closure-
+ * compiled block: one pre-decoded record per instruction holding a handler
+ * pointer and its operands. A block ends at a branch or jump (included) or
+ * before an instruction left to the interpreter (syscall, ll/sc, unknown).
+ * Blocks chain to their last successors, and a store to a page holding
+ * translated code drops every block on that page.
+ * Translations are keyed by virtual PC and shared by all cores. */
+
+class Core;
+class Pipeline;
+class BlockTranslator;
+
+struct DbtContext {
+    Pipeline* pipe;
+    Core* core;
+    BlockTranslator* dbt;
+};
+
+struct DbtInsn;
+typedef void (*DbtHandler)(DbtContext& c, const DbtInsn& in);
+
+struct DbtInsn {
+    DbtHandler fn;
+    uint8_t rs, rt, rd, shamt;
+    uint32_t imm;    /* Sign- or zero-extended as the opcode requires */
+    uint32_t pc;
+    uint32_t target; /* Branch destination */
+};
+
+struct DbtBlock {
+    uint32_t start, end;       /* [start, end) */
+    bool ends_in_branch;       /* Otherwise execution falls through to end */
+    std::vector<DbtInsn> insns;
+    std::vector<uint32_t> lines; /* Instruction cache lines, for fetch warming */
+    DbtBlock* chain[2];        /* Last successors: taken, fall-through */
+};
+
+/* Called on every translated memory access and block fetch */
+typedef void (*DbtWarmHook)(Core* core, uint32_t vaddr, bool is_write, bool is_fetch);
+
+class BlockTranslator {
+public:
+    BlockTranslator();
+
+    /* Executes about budget instructions functionally on core. Stops early
+     * when the core halts, leaves functional mode or waits at a barrier. */
+    void run(Core* core, int budget);
+
+    /* Reports a store; translations on its page are dropped before the next block */
+    void note_store(uint32_t vaddr) {
+        if (text_pages[vaddr >> 12]) pending_pages.push_back(vaddr >> 12);
+    }
+
+    DbtWarmHook warm;
+
+    /* Statistics */
+    uint64_t stat_blocks;        /* Translations made */
+    uint64_t stat_block_execs;
+    uint64_t stat_insts;         /* Instructions run from translated blocks */
+    uint64_t stat_chained;       /* Block transitions that skipped the lookup */
+    uint64_t stat_invalidations; /* Blocks dropped by stores to code */
+
+private:
+    std::unordered_map<uint32_t, std::unique_ptr<DbtBlock>> blocks;
+    std::unordered_map<uint32_t, uint32_t> entries;
+    std::vector<bool> text_pages;
+    std::vector<uint32_t> pending_pages;
+
+    DbtBlock* translate(uint32_t pc);
+    void interpret_block(Core* core, int& budget);
+    void flush_pending();
+};
+
+#endif
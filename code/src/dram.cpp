@@ -1,13 +1,20 @@
 #include "dram.h"
+#include "console.h"
+#include "observer.h"
+#include <cstdio>
+#include <cstring>
 
-DRAM::DRAM() : cmd_bus_avail_cycle(0), data_bus_avail_cycle(0) {
+DRAM::DRAM() : clock(DRAM_FREQ_MHZ), cmd_bus_avail_cycle(0), data_bus_avail_cycle(0), data_bus_core(-1) {
     // Banks initialized by default
+    memset(stat_interference, 0, sizeof(stat_interference));
+    memset(stat_requests, 0, sizeof(stat_requests));
+    stat_bursts = stat_row_hits = 0;
 }
 
 DRAM::AddressMapping DRAM::decode(uint32_t addr) const {
     /*
      * Spec:
-     * Bank = [7:5] (3 bits)
+     * Bank = [7:5] (3 bits), moved by DRAM_BANK_SHIFT
      * Row = [31:16] (16 bits)
      * Implicitly:
      * Offset = [4:0] (32 bytes)
@@ -19,7 +26,7 @@ DRAM::AddressMapping DRAM::decode(uint32_t addr) const {
     // uint32_t offset = addr & 0x1F;
     
     // 2. Bank [7:5]
-    uint32_t bank = (addr >> 5) & 0x7;
+    uint32_t bank = (addr >> DRAM_BANK_SHIFT) & (DRAM_BANKS - 1);
     
     // 3. Row [31:16]
     uint32_t row = (addr >> 16) & 0xFFFF;
@@ -51,14 +58,64 @@ bool DRAM::enqueue(bool is_write, uint32_t addr, int core_id, DRAM_Req::Source s
     req.source = src;
     
     active_requests.push_back(req); 
+    if (core_id >= 0 && core_id < NUM_CORES) stat_requests[core_id]++;
+    OBSERVE(on_dram_enqueue, core_id, addr, is_write);
 #ifdef DEBUG
-    printf("[DRAM] Enqueued Req %08x (Bank %d Row %d)\n", addr, bank_id, mapping.row);
+    console.print(CONSOLE_SYSTEM, "[DRAM] Enqueued Req %08x (Bank %d Row %d)\n", addr, bank_id, mapping.row);
 #endif
     return true;
 }
 
 
+uint64_t DRAM::data_offset(const DRAM_Req& req) const {
+    const Bank& bank = banks[req.bank_id];
+    bool row_hit = (bank.active && bank.active_row == req.row_index);
+    bool row_conflict = (bank.active && bank.active_row != req.row_index);
+
+    if (DRAM_PAGE_POLICY == 0) {
+        /* Open Row Policy */
+        if (row_hit) {
+            // READ/WRITE
+            return DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
+        } else if (row_conflict) {
+            // PRE(cmd) + ACT(cmd) + READ(cmd+bank)
+            return DRAM_PRE_CMD_BUS_BUSY_CYCLES + DRAM_ACT_CMD_BUS_BUSY_CYCLES +
+                   DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
+        } else {
+            // ACT(cmd) + READ(cmd+bank)
+            return DRAM_ACT_CMD_BUS_BUSY_CYCLES +
+                   DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
+        }
+    }
+
+    /* Closed Row Policy */
+    if (bank.active) {
+        // Conflict
+        return DRAM_PRE_CMD_BUS_BUSY_CYCLES + DRAM_ACT_CMD_BUS_BUSY_CYCLES +
+               DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
+    }
+    // ACT + READ
+    return DRAM_ACT_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
+}
+
+void DRAM::note_blocking(uint64_t current_cycle) {
+    for (DRAM_Req& req : active_requests) {
+        if (req.ready) continue;
+        const Bank& bank = banks[req.bank_id];
+        if (current_cycle < bank.bank_busy_until) {
+            req.wait_bank++;
+            note_interference(req.core_id, bank.busy_core, 1);
+        } else if (current_cycle + data_offset(req) < data_bus_avail_cycle) {
+            req.wait_bus++;
+            note_interference(req.core_id, data_bus_core, 1);
+        }
+    }
+}
+
 DRAM_Req DRAM::execute(uint64_t current_cycle) {
+    // Blocked requests wait this cycle whether or not the scheduler runs
+    note_blocking(current_cycle);
+
     /* 
      * 1. Check for Completions 
      */
@@ -66,6 +123,7 @@ DRAM_Req DRAM::execute(uint64_t current_cycle) {
         if (it->ready && it->completion_cycle <= current_cycle) {
             DRAM_Req completed = *it;
             it = active_requests.erase(it);
+            OBSERVE(on_dram_complete, completed.core_id, completed.addr);
             return completed; // Return one completion per cycle max
         } else {
             ++it;
@@ -98,55 +156,23 @@ DRAM_Req DRAM::execute(uint64_t current_cycle) {
          * Determine Latencies & Resource Checks 
          */
         bool row_hit = (bank.active && bank.active_row == req.row_index);
-        bool row_conflict = (bank.active && bank.active_row != req.row_index);
-        
-        uint64_t cmd_latency = 0; // Latency until Data Transfer Starts
-        uint64_t data_start_offset = 0;
         
         /* Check Bank Availability for Initial Command */
         if (current_cycle < bank.bank_busy_until) {
 #ifdef DEBUG
-            if (active_requests.size() < 5) printf("[DRAM] Skip %08x: Bank %d Busy until %llu (Curr %llu)\n", req.addr, req.bank_id, bank.bank_busy_until, current_cycle);
+            if (active_requests.size() < 5) console.print(CONSOLE_SYSTEM, "[DRAM] Skip %08x: Bank %d Busy until %llu (Curr %llu)\n", req.addr, req.bank_id, bank.bank_busy_until, current_cycle);
 #endif
             continue; 
         }
 
         bool is_open_policy = (DRAM_PAGE_POLICY == 0);
-
-        if (is_open_policy) {
-            /* Open Row Policy */
-            if (row_hit) {
-                // READ/WRITE
-                data_start_offset = DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
-            } else if (row_conflict) {
-                 // PRE(cmd) + ACT(cmd) + READ(cmd+bank)
-                 data_start_offset = DRAM_PRE_CMD_BUS_BUSY_CYCLES + 
-                                     DRAM_ACT_CMD_BUS_BUSY_CYCLES + 
-                                     DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
-            } else {
-                 // ACT(cmd) + READ(cmd+bank)
-                 data_start_offset = DRAM_ACT_CMD_BUS_BUSY_CYCLES + 
-                                     DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
-            }
-        } else {
-            /* Closed Row Policy */
-            if (bank.active) {
-                // Conflict
-                 data_start_offset = DRAM_PRE_CMD_BUS_BUSY_CYCLES + 
-                                     DRAM_ACT_CMD_BUS_BUSY_CYCLES + 
-                                     DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
-            } else {
-                // ACT + READ
-                data_start_offset = DRAM_ACT_CMD_BUS_BUSY_CYCLES + 
-                                    DRAM_RDWR_CMD_BUS_BUSY_CYCLES + DRAM_RDWR_BANK_BUSY_CYCLES;
-            }
-        }
+        uint64_t data_start_offset = data_offset(req);
 
         // Check Data Bus Availability
         uint64_t data_start_abs = current_cycle + data_start_offset;
         if (data_start_abs < data_bus_avail_cycle) {
 #ifdef DEBUG
-            if (active_requests.size() < 5) printf("[DRAM] Skip %08x: Data Bus Busy (Start %llu < Avail %llu)\n", req.addr, data_start_abs, data_bus_avail_cycle);
+            if (active_requests.size() < 5) console.print(CONSOLE_SYSTEM, "[DRAM] Skip %08x: Data Bus Busy (Start %llu < Avail %llu)\n", req.addr, data_start_abs, data_bus_avail_cycle);
 #endif
             continue; // Collision on Data Bus
         }
@@ -207,6 +233,13 @@ DRAM_Req DRAM::execute(uint64_t current_cycle) {
         }
         cmd_bus_avail_cycle = current_cycle + initial_cmd_cycles; 
 
+        // Row closed by another core: the PRE+ACT overhead is interference
+        if (row_conflict) {
+            note_interference(req.core_id, bank.busy_core, DRAM_PRE_CMD_BUS_BUSY_CYCLES + DRAM_ACT_CMD_BUS_BUSY_CYCLES);
+        }
+        bank.busy_core = req.core_id;
+        data_bus_core = req.core_id;
+
         uint64_t latency = 0;
         
         // Helper to sum latencies
@@ -260,6 +293,11 @@ DRAM_Req DRAM::execute(uint64_t current_cycle) {
         
         req.ready = true;
         req.completion_cycle = current_cycle + latency;
+        stat_bursts++;
+        if (row_hit) stat_row_hits++;
+        req.burst_cycles = DRAM_RDWR_DATA_BUS_BUSY_CYCLES;
+        req.access_cycles = latency - DRAM_RDWR_DATA_BUS_BUSY_CYCLES;
+        OBSERVE(on_dram_schedule, req.core_id, req.addr, req.bank_id, row_hit);
     }
     
     return DRAM_Req(); // Invalid (nothing completed)
@@ -6,6 +6,7 @@
 #include <deque>
 #include <optional>
 #include "config.h"
+#include "clock.h"
 
 struct DRAM_Req {
     bool valid;
@@ -15,6 +16,11 @@ struct DRAM_Req {
     int core_id;
     uint64_t arrival_cycle;
     uint64_t completion_cycle;
+
+    // Miss latency attribution (DRAM cycles): cycles blocked by a busy bank
+    // or data bus before scheduling, then bank access and burst once scheduled
+    uint32_t wait_bank, wait_bus;
+    uint32_t access_cycles, burst_cycles;
     
     // Decoded info for scheduling
     uint32_t bank_id;
@@ -24,20 +30,24 @@ struct DRAM_Req {
     enum Source { SRC_FETCH, SRC_MEMORY };
     Source source; 
     
-    DRAM_Req() : valid(false), ready(false), addr(0), is_write(false), core_id(0), arrival_cycle(0), completion_cycle(0), bank_id(0), row_index(0), source(SRC_FETCH) {}
+    DRAM_Req() : valid(false), ready(false), addr(0), is_write(false), core_id(0), arrival_cycle(0), completion_cycle(0), wait_bank(0), wait_bus(0), access_cycles(0), burst_cycles(0), bank_id(0), row_index(0), source(SRC_FETCH) {}
 };
 
 struct Bank {
     bool active;
     uint32_t active_row;
     uint64_t bank_busy_until; // Spec: Bank busy for 100 cycles after command
+    int busy_core; // Core whose request occupies the bank / opened the row (-1: writeback)
     
-    Bank() : active(false), active_row(0), bank_busy_until(0) {}
+    Bank() : active(false), active_row(0), bank_busy_until(0), busy_core(-1) {}
 };
 
 class DRAM {
 public:
     Bank banks[TOTAL_BANKS];
+
+    /* DRAM clock domain. Timing parameters are in DRAM cycles. */
+    ClockDomain clock;
     
     // In-flight requests (serving as both queue and active list for this skeleton)
     std::vector<DRAM_Req> active_requests;
@@ -46,6 +56,18 @@ public:
     /* We need to track when buses will be free to schedule future commands */
     uint64_t cmd_bus_avail_cycle; // When command bus is free next
     uint64_t data_bus_avail_cycle; // When data bus is free next
+    int data_bus_core; // Core whose burst occupies the data bus
+
+    /* Inter-core interference (DRAM cycles): [victim][interferer].
+     * Bank busy and data bus waits caused by another core's request, plus
+     * PRE+ACT overhead when another core closed the victim's row. Read by FST. */
+    uint64_t stat_interference[NUM_CORES][NUM_CORES];
+
+    /* Requests enqueued on behalf of each core (performance counters) */
+    uint64_t stat_requests[NUM_CORES];
+
+    /* Scheduled requests (one burst each) and those that hit the open row */
+    uint64_t stat_bursts, stat_row_hits;
     
     /* Decoded Address Components */
     struct AddressMapping {
@@ -60,6 +82,19 @@ public:
     /* Decode helper */
     AddressMapping decode(uint32_t addr) const;
     
+    /* Charge cycles of delay suffered by victim because of interferer */
+    void note_interference(int victim, int interferer, uint64_t cycles) {
+        if (victim >= 0 && interferer >= 0 && victim != interferer)
+            stat_interference[victim][interferer] += cycles;
+    }
+
+    /* Cycles from a request's first command to its data transfer, given the bank's row state */
+    uint64_t data_offset(const DRAM_Req& req) const;
+
+    /* Every DRAM cycle: counts the cycle as a bank or data bus wait of each
+     * blocked request, and as interference if another core's access blocks it */
+    void note_blocking(uint64_t current_cycle);
+
     /* Get flattened bank index */
     uint32_t get_flat_bank_id(uint32_t addr) const;
 
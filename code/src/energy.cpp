@@ -0,0 +1,59 @@
+#include "energy.h"
+#include "processor.h"
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+CacheEnergyParams cache_energy_params(uint32_t sets, uint32_t ways, uint32_t block_size) {
+    static const std::vector<CacheEnergyTableEntry> table = CACHE_ENERGY_TABLE;
+    for (const auto& e : table) {
+        if (e.sets == sets && e.ways == ways && e.block_size == block_size) return e.params;
+    }
+
+    // Geometry estimate: per-bit cost grows with bitline length (~sqrt(rows)),
+    // normalized to a 64-set array.
+    double rows_factor = std::sqrt((double)sets / 64.0);
+    uint32_t offset_bits = (uint32_t)std::log2(block_size);
+    uint32_t index_bits = (uint32_t)std::log2(sets);
+    uint32_t tag_bits = 32 - offset_bits - index_bits + 2; // + MESI state
+    uint32_t block_bits = block_size * 8;
+
+    CacheEnergyParams p;
+    p.tag_nj = ways * tag_bits * ENERGY_TAG_PJ_PER_BIT * rows_factor / 1000.0;
+    p.read_nj = block_bits * ENERGY_DATA_PJ_PER_BIT * rows_factor / 1000.0;
+    p.write_nj = p.read_nj * ENERGY_WRITE_FACTOR;
+    p.snoop_nj = p.tag_nj;
+    double total_bits = (double)sets * ways * (block_bits + tag_bits);
+    p.leakage_mw = total_bits * ENERGY_LEAK_NW_PER_BIT / 1e6;
+    return p;
+}
+
+static void print_level(const char* name, double dyn, double leak) {
+    printf("%sDynamic_nJ: %.3f\n", name, dyn);
+    printf("%sLeakage_nJ: %.3f\n", name, leak);
+}
+
+void energy_report(const Processor& p, uint64_t cycles) {
+    double l1i_dyn = 0, l1i_leak = 0, l1d_dyn = 0, l1d_leak = 0;
+    for (const auto& core : p.cores) {
+        l1i_dyn += core->icache.energy.dynamic_nj();
+        l1i_leak += core->icache.energy.leakage_nj(cycles);
+        l1d_dyn += core->dcache.energy.dynamic_nj();
+        l1d_leak += core->dcache.energy.leakage_nj(cycles);
+    }
+    double l2_dyn = 0, l2_leak = 0;
+    for (const L2Cache* l2 : p.l2s) {
+        l2_dyn += l2->energy.dynamic_nj();
+        l2_leak += l2->energy.leakage_nj(cycles);
+    }
+
+    print_level("L1I", l1i_dyn, l1i_leak);
+    print_level("L1D", l1d_dyn, l1d_leak);
+    print_level("L2", l2_dyn, l2_leak);
+
+    double total_nj = l1i_dyn + l1i_leak + l1d_dyn + l1d_leak + l2_dyn + l2_leak;
+    double time_ns = cycles * 1000.0 / CLOCK_FREQ_MHZ;
+    printf("CacheEnergy_nJ: %.3f\n", total_nj);
+    printf("Time_ns: %.1f\n", time_ns);
+    printf("EDP_Js: %.6e\n", (total_nj * 1e-9) * (time_ns * 1e-9));
+}
@@ -0,0 +1,60 @@
+#ifndef _ENERGY_H_
+#define _ENERGY_H_
+
+#include "config.h"
+#include "clock.h"
+#include <cstdint>
+
+/* Per-cache energy accounting. Events are counted on the access paths and
+ * converted to energy with per-event costs, either taken from
+ * CACHE_ENERGY_TABLE or estimated from the cache geometry. Events are
+ * weighted by (V/V_nom)^2 of the cache's clock domain at the time they occur. */
+
+struct CacheEnergyParams {
+    double tag_nj;     /* Tag lookup (all ways) */
+    double read_nj;    /* Data array read (one block) */
+    double write_nj;   /* Data array write (one block) */
+    double snoop_nj;   /* Coherence snoop (tag-only probe) */
+    double leakage_mw; /* Static power */
+};
+
+struct CacheEnergyTableEntry {
+    uint32_t sets, ways, block_size;
+    CacheEnergyParams params;
+};
+
+/* Table lookup, falling back to the geometry-based estimate */
+CacheEnergyParams cache_energy_params(uint32_t sets, uint32_t ways, uint32_t block_size);
+
+struct CacheEnergy {
+    CacheEnergyParams params;
+    const ClockDomain* clock; /* Supplies the operating voltage */
+    double tag_accesses, data_reads, data_writes, snoops;
+
+    CacheEnergy() : params{}, clock(nullptr), tag_accesses(0), data_reads(0), data_writes(0), snoops(0) {}
+
+    double scale() const { return clock ? clock->dynamic_scale() : 1.0; }
+
+    void charge_tag()   { tag_accesses += scale(); }
+    void charge_read()  { data_reads += scale(); }
+    void charge_write() { data_writes += scale(); }
+    void charge_snoop() { snoops += scale(); }
+
+    double dynamic_nj() const {
+        return tag_accesses * params.tag_nj + data_reads * params.read_nj +
+               data_writes * params.write_nj + snoops * params.snoop_nj;
+    }
+
+    /* mW * ns = pJ. Uses the domain's voltage-weighted elapsed time. */
+    double leakage_nj(uint64_t cycles) const {
+        double ns = clock ? clock->leak_ns : cycles * 1000.0 / CLOCK_FREQ_MHZ;
+        return params.leakage_mw * ns / 1000.0;
+    }
+};
+
+class Processor;
+
+/* Prints per-level energy, total energy and energy-delay product */
+void energy_report(const Processor& p, uint64_t cycles);
+
+#endif
@@ -0,0 +1,153 @@
+#include "epoch.h"
+#include "processor.h"
+#include <cstring>
+#include <string>
+
+EpochSampler::EpochSampler() : length(0), file(nullptr), binary(false), next(0) {
+    memset(&last, 0, sizeof(last));
+    memset(occ_l1_mshr, 0, sizeof(occ_l1_mshr));
+    occ_l2_mshr = occ_dram_queue = occ_samples = 0;
+}
+
+EpochSampler::~EpochSampler() {
+    if (file) fclose(file);
+}
+
+void EpochSampler::read(const Processor& p, EpochCounters& c) const {
+    c.cycle = stat_cycles;
+    for (int i = 0; i < NUM_CORES; i++) {
+        const Core& core = *p.cores[i];
+        c.retired[i] = core.stat_inst_retire;
+        c.l1i_hits[i] = core.icache.stat_hits;
+        c.l1i_misses[i] = core.icache.stat_misses;
+        c.l1d_hits[i] = core.dcache.stat_hits;
+        c.l1d_misses[i] = core.dcache.stat_misses;
+    }
+    c.l2_accesses = c.l2_misses = 0;
+    for (const L2Cache* l2 : p.l2s) {
+        c.l2_accesses += l2->stat_demand_accesses;
+        for (int i = 0; i < NUM_CORES; i++) c.l2_misses += l2->stat_misses[i];
+    }
+    c.dram_bursts = p.dram.stat_bursts;
+    c.dram_row_hits = p.dram.stat_row_hits;
+}
+
+void EpochSampler::accumulate(const Processor& p) {
+    for (int i = 0; i < NUM_CORES; i++) {
+        occ_l1_mshr[i] += p.cores[i]->icache.mshr.valid + p.cores[i]->dcache.mshr.valid;
+    }
+    for (const L2Cache* l2 : p.l2s) {
+        for (int i = 0; i < L2_MSHR_SIZE; i++) occ_l2_mshr += l2->mshrs[i].valid;
+    }
+    occ_dram_queue += p.dram.active_requests.size();
+    occ_samples++;
+}
+
+static double ratio(uint64_t num, uint64_t den) {
+    return den ? (double)num / den : 0.0;
+}
+
+void EpochSampler::write_header() {
+    std::vector<std::string> cols = {"cycle", "cycles"};
+    for (int i = 0; i < NUM_CORES; i++) {
+        std::string c = "core" + std::to_string(i) + "_";
+        cols.push_back(c + "ipc");
+        cols.push_back(c + "l1i_miss_rate");
+        cols.push_back(c + "l1d_miss_rate");
+        cols.push_back(c + "l1_mshr_occupancy");
+    }
+    for (const char* c : {"l2_miss_rate", "l2_mshr_occupancy", "dram_queue_occupancy",
+                          "dram_row_hit_rate", "dram_bytes", "dram_gbps"}) {
+        cols.push_back(c);
+    }
+
+    if (binary) {
+        uint32_t n = cols.size();
+        fwrite("MSEP", 1, 4, file);
+        fwrite(&n, sizeof(n), 1, file);
+        for (const auto& c : cols) fwrite(c.c_str(), 1, c.size() + 1, file);
+    } else {
+        for (size_t i = 0; i < cols.size(); i++) fprintf(file, "%s%s", i ? "," : "", cols[i].c_str());
+        fprintf(file, "\n");
+    }
+    row.reserve(cols.size());
+}
+
+void EpochSampler::snapshot(const Processor& p) {
+    EpochCounters now;
+    read(p, now);
+    uint64_t cycles = now.cycle - last.cycle;
+    if (cycles == 0) return;
+
+    row.clear();
+    row.push_back(now.cycle);
+    row.push_back(cycles);
+    for (int i = 0; i < NUM_CORES; i++) {
+        uint64_t im = now.l1i_misses[i] - last.l1i_misses[i];
+        uint64_t dm = now.l1d_misses[i] - last.l1d_misses[i];
+        row.push_back(ratio(now.retired[i] - last.retired[i], cycles));
+        row.push_back(ratio(im, im + now.l1i_hits[i] - last.l1i_hits[i]));
+        row.push_back(ratio(dm, dm + now.l1d_hits[i] - last.l1d_hits[i]));
+        row.push_back(ratio(occ_l1_mshr[i], occ_samples));
+    }
+    uint64_t bursts = now.dram_bursts - last.dram_bursts;
+    double bytes = (double)bursts * BLOCK_SIZE;
+    row.push_back(ratio(now.l2_misses - last.l2_misses, now.l2_accesses - last.l2_accesses));
+    row.push_back(ratio(occ_l2_mshr, occ_samples));
+    row.push_back(ratio(occ_dram_queue, occ_samples));
+    row.push_back(ratio(now.dram_row_hits - last.dram_row_hits, bursts));
+    row.push_back(bytes);
+    row.push_back(bytes / cycles * CLOCK_FREQ_MHZ / 1000.0); // Bytes per base cycle * MHz / 1000 = GB/s
+
+    if (binary) {
+        fwrite(row.data(), sizeof(double), row.size(), file);
+    } else {
+        for (size_t i = 0; i < row.size(); i++) {
+            // Counts as integers, rates with fixed precision
+            bool count = i < 2 || i == row.size() - 2;
+            fprintf(file, count ? "%s%.0f" : "%s%.4f", i ? "," : "", row[i]);
+        }
+        fprintf(file, "\n");
+    }
+
+    last = now;
+    memset(occ_l1_mshr, 0, sizeof(occ_l1_mshr));
+    occ_l2_mshr = occ_dram_queue = occ_samples = 0;
+    next = now.cycle + length;
+}
+
+bool EpochSampler::start(const Processor& p, uint64_t len, const char* path) {
+    stop(p);
+    size_t n = strlen(path);
+    binary = n >= 4 && strcmp(path + n - 4, ".bin") == 0;
+    file = fopen(path, binary ? "wb" : "w");
+    if (!file) return false;
+
+    write_header();
+    read(p, last);
+    memset(occ_l1_mshr, 0, sizeof(occ_l1_mshr));
+    occ_l2_mshr = occ_dram_queue = occ_samples = 0;
+    length = len;
+    next = last.cycle + length;
+    return true;
+}
+
+void EpochSampler::finish(const Processor& p) {
+    if (length == 0) return;
+    snapshot(p);
+    fflush(file);
+}
+
+void EpochSampler::stop(const Processor& p) {
+    if (length == 0) return;
+    snapshot(p);
+    fclose(file);
+    file = nullptr;
+    length = 0;
+}
+
+uint64_t EpochSampler::until_next() const {
+    if (length == 0) return UINT64_MAX;
+    // Land one cycle short, so the next simulated cycle reaches the boundary
+    return next > (uint64_t)stat_cycles + 1 ? next - stat_cycles - 1 : 0;
+}
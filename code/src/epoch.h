@@ -0,0 +1,75 @@
+#ifndef _EPOCH_H_
+#define _EPOCH_H_
+
+#include "config.h"
+#include "shell.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+class Processor;
+
+/* Epoch time series (shell "epoch <cycles> <file>", mipssim_set_epoch).
+ * Every length base cycles, the change of each counter over the epoch is
+ * written as one row: per-core IPC, L1I/L1D miss rates and outstanding L1
+ * misses, L2 miss rate and MSHR occupancy, DRAM queue occupancy, row-hit
+ * rate and bandwidth. Occupancies are averaged over samples taken every
+ * EPOCH_OCCUPANCY_SAMPLE cycles (skipped idle cycles are not sampled).
+ * A file ending in ".bin" gets a binary series (see EpochSampler::start),
+ * anything else CSV. The sampler costs one branch per cycle while stopped. */
+
+/* Cumulative counters at an epoch boundary */
+struct EpochCounters {
+    uint64_t cycle;
+    uint64_t retired[NUM_CORES];
+    uint64_t l1i_hits[NUM_CORES], l1i_misses[NUM_CORES];
+    uint64_t l1d_hits[NUM_CORES], l1d_misses[NUM_CORES];
+    uint64_t l2_accesses, l2_misses;
+    uint64_t dram_bursts, dram_row_hits;
+};
+
+class EpochSampler {
+public:
+    EpochSampler();
+    ~EpochSampler();
+
+    /* Starts a series in path with a row every length base cycles (replacing
+     * any running series). Binary files hold "MSEP", the uint32 column count,
+     * the NUL-terminated column names, then rows of doubles. False if path
+     * cannot be created. */
+    bool start(const Processor& p, uint64_t length, const char* path);
+
+    /* Writes the partial last epoch, if any, and closes the series */
+    void stop(const Processor& p);
+
+    /* Writes the partial epoch up to now and flushes (the program halted) */
+    void finish(const Processor& p);
+
+    /* After every simulated base cycle: occupancy samples, and a row when due */
+    void tick(const Processor& p) {
+        if (length == 0) return;
+        if (stat_cycles % EPOCH_OCCUPANCY_SAMPLE == 0) accumulate(p);
+        if (stat_cycles >= next) snapshot(p);
+    }
+
+    /* Base cycles that can be skipped without passing a boundary */
+    uint64_t until_next() const;
+
+    uint64_t length; /* 0 = stopped */
+
+private:
+    FILE* file;
+    bool binary;
+    uint64_t next;
+    EpochCounters last;
+    uint64_t occ_l1_mshr[NUM_CORES], occ_l2_mshr, occ_dram_queue; /* Summed over samples */
+    uint64_t occ_samples;
+    std::vector<double> row;
+
+    void read(const Processor& p, EpochCounters& c) const;
+    void accumulate(const Processor& p);
+    void snapshot(const Processor& p);
+    void write_header();
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "fst.h"
+#include "processor.h"
+#include "console.h"
+#include <cstdio>
+#include <cstring>
+
+static const int fst_levels[] = FST_LEVELS;
+static const int fst_num_levels = sizeof(fst_levels) / sizeof(fst_levels[0]);
+
+FSTController::FSTController(Processor* p)
+    : proc(p), interval_start(0), unfairness(1.0), stat_intervals(0), stat_throttle_downs(0)
+{
+    for (int i = 0; i < NUM_CORES; i++) {
+        level[i] = fst_num_levels - 1; // Unthrottled
+        next_issue[i] = 0;
+        slowdown[i] = 1.0;
+    }
+}
+
+int FSTController::rate(int core_id) const {
+    return fst_levels[level[core_id]];
+}
+
+void FSTController::on_issue(int core_id, uint64_t now) {
+    if (!FST_ENABLE) return;
+    // Gap grows as the rate drops: 0 at 100%, FST_ISSUE_GAP at 50%
+    int pct = rate(core_id);
+    next_issue[core_id] = now + (uint64_t)FST_ISSUE_GAP * (100 - pct) / pct;
+}
+
+void FSTController::cycle(uint64_t current_cycle) {
+    if (current_cycle - interval_start < FST_INTERVAL) return;
+
+    DRAM& dram = proc->dram;
+    uint64_t t_shared = current_cycle - interval_start;
+
+    // Convert interference to base cycles (private L2s see none from other cores)
+    double dram_scale = (double)CLOCK_FREQ_MHZ / dram.clock.freq_mhz;
+    double caused[NUM_CORES][NUM_CORES];
+
+    int slowest = -1, fastest = -1;
+    for (int i = 0; i < NUM_CORES; i++) {
+        double excess = 0;
+        for (int j = 0; j < NUM_CORES; j++) {
+            caused[i][j] = dram.stat_interference[i][j] * dram_scale;
+            for (auto* l2 : proc->l2s) {
+                caused[i][j] += l2->stat_interference[i][j] * ((double)CLOCK_FREQ_MHZ / l2->clock.freq_mhz);
+            }
+            excess += caused[i][j];
+        }
+        if (excess > t_shared - 1) excess = t_shared - 1;
+        slowdown[i] = t_shared / (t_shared - excess);
+
+        if (!proc->cores[i]->is_running) continue;
+        if (slowest == -1 || slowdown[i] > slowdown[slowest]) slowest = i;
+        if (fastest == -1 || slowdown[i] < slowdown[fastest]) fastest = i;
+    }
+
+    unfairness = (slowest >= 0) ? slowdown[slowest] / slowdown[fastest] : 1.0;
+
+    if (slowest >= 0 && slowest != fastest && unfairness > FST_UNFAIRNESS_TARGET) {
+        // Throttle the core that caused the slowest core the most interference
+        int interferer = -1;
+        for (int j = 0; j < NUM_CORES; j++) {
+            if (j == slowest || !proc->cores[j]->is_running) continue;
+            if (interferer == -1 || caused[slowest][j] > caused[slowest][interferer]) interferer = j;
+        }
+        if (interferer >= 0 && caused[slowest][interferer] > 0 && level[interferer] > 0) {
+            level[interferer]--;
+            stat_throttle_downs++;
+        }
+        if (level[slowest] < fst_num_levels - 1) level[slowest]++;
+    } else {
+        for (int i = 0; i < NUM_CORES; i++) {
+            if (level[i] < fst_num_levels - 1) level[i]++;
+        }
+    }
+
+#ifdef DEBUG
+    console.print(CONSOLE_SYSTEM, "[FST] Interval end %lu: unfairness %.3f, slowest %d\n", current_cycle, unfairness, slowest);
+#endif
+
+    memset(dram.stat_interference, 0, sizeof(dram.stat_interference));
+    for (auto* l2 : proc->l2s) {
+        memset(l2->stat_interference, 0, sizeof(l2->stat_interference));
+    }
+    interval_start = current_cycle;
+    stat_intervals++;
+}
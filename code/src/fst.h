@@ -0,0 +1,47 @@
+#ifndef _FST_H_
+#define _FST_H_
+
+#include "config.h"
+#include <cstdint>
+
+/* Fairness via Source Throttling.
+ * Every FST_INTERVAL cycles, estimates each running core's slowdown from the
+ * interference counters in the L2 and DRAM:
+ *     slowdown = T_shared / (T_shared - T_excess)
+ * If max/min slowdown exceeds FST_UNFAIRNESS_TARGET, the core that interfered
+ * most with the slowest core is throttled down one level and the slowest core
+ * is throttled up; otherwise every core moves back towards unthrottled.
+ * Throttling gates the issue of new misses in L1Cache::access. */
+
+class Processor;
+
+class FSTController {
+public:
+    FSTController(Processor* p);
+
+    Processor* proc;
+
+    int level[NUM_CORES];          /* Index into FST_LEVELS */
+    uint64_t next_issue[NUM_CORES]; /* Core cycle at which the next miss may issue */
+    uint64_t interval_start;
+
+    /* Statistics */
+    double slowdown[NUM_CORES];    /* Estimate from the last interval */
+    double unfairness;
+    uint64_t stat_intervals;
+    uint64_t stat_throttle_downs;
+
+    /* Request-issue gating (core cycles) */
+    bool may_issue(int core_id, uint64_t now) const {
+        return !FST_ENABLE || now >= next_issue[core_id];
+    }
+    void on_issue(int core_id, uint64_t now);
+
+    /* Current injection rate of a core, in percent */
+    int rate(int core_id) const;
+
+    /* Called every base cycle; acts at interval boundaries */
+    void cycle(uint64_t current_cycle);
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "latency.h"
+#include "shell.h"
+#include <cstdio>
+#include <cstring>
+
+static const char* component_names[LAT_COMPONENTS] = {
+    "MshrWait", "Snoop", "L2Hit", "ReqQueue", "DramQueue", "BankWait",
+    "BusWait", "Bank", "Burst", "RetQueue", "Fill"
+};
+
+static const char* type_names[LAT_TYPES] = {"Ifetch", "Load", "Store"};
+
+LatencyProfiler::LatencyProfiler() {
+    memset(stat_misses, 0, sizeof(stat_misses));
+    memset(stat_paths, 0, sizeof(stat_paths));
+    memset(stat_sum, 0, sizeof(stat_sum));
+    memset(stat_hist, 0, sizeof(stat_hist));
+}
+
+void LatencyProfiler::dram_complete(const DRAM_Req& req, const ClockDomain& dram_clock) {
+    if (req.core_id < 0) return; // Writeback: nobody waits on it
+    static const ClockDomain base_clock;
+
+    FillTrace& f = fills[req.addr & ~(BLOCK_SIZE - 1)];
+    f.valid = true;
+    f.enqueue = req.arrival_cycle;
+    f.complete = stat_cycles;
+    f.bank_wait = base_clock.from(req.wait_bank, dram_clock);
+    f.bus_wait = base_clock.from(req.wait_bus, dram_clock);
+    f.bank = base_clock.from(req.access_cycles, dram_clock);
+    f.burst = base_clock.from(req.burst_cycles, dram_clock);
+}
+
+FillTrace LatencyProfiler::take(uint32_t block) {
+    FillTrace f;
+    auto it = fills.find(block);
+    if (it != fills.end()) {
+        f = it->second;
+        f.ret = stat_cycles;
+        fills.erase(it);
+    }
+    return f;
+}
+
+// Moves up to n cycles of the remaining DRAM time into component c
+static void charge(uint64_t* c, int comp, uint64_t n, uint64_t* remaining) {
+    if (n > *remaining) n = *remaining;
+    c[comp] = n;
+    *remaining -= n;
+}
+
+void LatencyProfiler::record(int core_id, LatencyType type, const MissTrace& t) {
+    uint64_t c[LAT_COMPONENTS] = {};
+    uint64_t now = stat_cycles;
+    uint64_t first = t.first < t.issue ? t.first : t.issue;
+    c[LAT_MSHR_WAIT] = t.issue - first;
+
+    const FillTrace& f = t.fill;
+    if (t.path == MISS_SNOOP) {
+        c[LAT_SNOOP] = now - t.issue;
+    } else if (t.path == MISS_L2) {
+        c[LAT_L2_HIT] = now - t.issue;
+    } else if (!f.valid) {
+        c[LAT_MSHR_WAIT] += now - t.issue; // No DRAM trace: waited on the L2
+    } else if (t.merged || f.enqueue < t.issue) {
+        // Another core's fill: the L2 MSHR wait ends when it completes
+        c[LAT_MSHR_WAIT] += f.ret - t.issue;
+        c[LAT_FILL] = now - f.ret;
+    } else {
+        c[LAT_REQ_QUEUE] = f.enqueue - t.issue;
+        uint64_t dram = f.complete - f.enqueue;
+        charge(c, LAT_BURST, f.burst, &dram);
+        charge(c, LAT_BANK, f.bank, &dram);
+        charge(c, LAT_BANK_WAIT, f.bank_wait, &dram);
+        charge(c, LAT_BUS_WAIT, f.bus_wait, &dram);
+        c[LAT_DRAM_QUEUE] = dram;
+        c[LAT_RET_QUEUE] = f.ret - f.complete;
+        c[LAT_FILL] = now - f.ret;
+    }
+
+    stat_misses[core_id][type]++;
+    stat_paths[core_id][type][t.path]++;
+    uint64_t total = 0;
+    for (int i = 0; i <= LAT_COMPONENTS; i++) {
+        uint64_t v = (i < LAT_COMPONENTS) ? c[i] : total;
+        if (i < LAT_COMPONENTS) {
+            stat_sum[core_id][type][i] += v;
+            total += v;
+        }
+        int b = 0;
+        while (v && b < LAT_BUCKETS - 1) {
+            v >>= 1;
+            b++;
+        }
+        stat_hist[i][b]++;
+    }
+}
+
+static void print_row(const char* name, uint64_t misses, const uint64_t* paths, const uint64_t* sum) {
+    uint64_t total = 0;
+    for (int i = 0; i < LAT_COMPONENTS; i++) total += sum[i];
+    printf("%s: misses %lu snoop %lu l2 %lu dram %lu avg %.2f |", name, misses,
+           paths[MISS_SNOOP], paths[MISS_L2], paths[MISS_DRAM], misses ? (double)total / misses : 0.0);
+    for (int i = 0; i < LAT_COMPONENTS; i++) {
+        printf(" %s %.2f", component_names[i], misses ? (double)sum[i] / misses : 0.0);
+    }
+    printf("\n");
+}
+
+void LatencyProfiler::report() const {
+    uint64_t misses = 0, total = 0;
+    uint64_t type_misses[LAT_TYPES] = {};
+    uint64_t type_paths[LAT_TYPES][3] = {};
+    uint64_t type_sum[LAT_TYPES][LAT_COMPONENTS] = {};
+    for (int c = 0; c < NUM_CORES; c++) {
+        for (int t = 0; t < LAT_TYPES; t++) {
+            type_misses[t] += stat_misses[c][t];
+            for (int p = 0; p < 3; p++) type_paths[t][p] += stat_paths[c][t][p];
+            for (int i = 0; i < LAT_COMPONENTS; i++) {
+                type_sum[t][i] += stat_sum[c][t][i];
+                total += stat_sum[c][t][i];
+            }
+        }
+    }
+    for (int t = 0; t < LAT_TYPES; t++) misses += type_misses[t];
+    printf("MissLatencyMisses: %lu\n", misses);
+    printf("MissLatencyAvg: %.2f\n", misses ? (double)total / misses : 0.0);
+
+    char name[64];
+    for (int t = 0; t < LAT_TYPES; t++) {
+        snprintf(name, sizeof(name), "MissLatency%s", type_names[t]);
+        print_row(name, type_misses[t], type_paths[t], type_sum[t]);
+    }
+    for (int c = 0; c < NUM_CORES; c++) {
+        for (int t = 0; t < LAT_TYPES; t++) {
+            if (stat_misses[c][t] == 0) continue;
+            snprintf(name, sizeof(name), "MissLatencyCore%d%s", c, type_names[t]);
+            print_row(name, stat_misses[c][t], stat_paths[c][t], stat_sum[c][t]);
+        }
+    }
+
+    // Non-empty buckets as <low>-<high>:<count>
+    for (int i = 0; i <= LAT_COMPONENTS; i++) {
+        printf("MissLatencyHist%s:", i < LAT_COMPONENTS ? component_names[i] : "Total");
+        for (int b = 0; b < LAT_BUCKETS; b++) {
+            if (stat_hist[i][b] == 0) continue;
+            if (b == 0) printf(" 0:%lu", stat_hist[i][b]);
+            else if (b == 1) printf(" 1:%lu", stat_hist[i][b]);
+            else if (b == LAT_BUCKETS - 1) printf(" %lu+:%lu", 1ul << (b - 1), stat_hist[i][b]);
+            else printf(" %lu-%lu:%lu", 1ul << (b - 1), (1ul << b) - 1, stat_hist[i][b]);
+        }
+        printf("\n");
+    }
+}
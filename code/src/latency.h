@@ -0,0 +1,88 @@
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include "config.h"
+#include "dram.h"
+#include <cstdint>
+#include <unordered_map>
+
+/* End-to-end miss latency attribution (MISS_LATENCY_PROFILE).
+ * Every L1 miss is timed in base cycles from its first attempt to its fill,
+ * and the time is split across the stages it went through:
+ *   MshrWait   stalled before the L1 MSHR was allocated (write exclusion,
+ *              FST gating, L2 MSHRs busy or full), or riding on another
+ *              core's pending L2 MSHR as a merged target
+ *   Snoop      cache-to-cache transfer from another L1 (or private L2)
+ *   L2Hit      served by the L2
+ *   ReqQueue   L2 to DRAM request queue
+ *   DramQueue  waiting in the controller for the command bus or a turn
+ *   BankWait   waiting for a bank still busy with another request
+ *   BusWait    waiting for the data bus
+ *   Bank       own PRE/ACT/RD commands and bank latency
+ *   Burst      data transfer on the bus
+ *   RetQueue   DRAM to L2 return queue
+ *   Fill       L2 MSHR completion to the L1 fill (synchronizer, retry)
+ * The components of a miss always sum to its total. DRAM components are
+ * counted in DRAM cycles and converted to base cycles. */
+
+enum MissPath { MISS_SNOOP, MISS_L2, MISS_DRAM };
+
+enum LatencyComponent {
+    LAT_MSHR_WAIT, LAT_SNOOP, LAT_L2_HIT, LAT_REQ_QUEUE, LAT_DRAM_QUEUE, LAT_BANK_WAIT,
+    LAT_BUS_WAIT, LAT_BANK, LAT_BURST, LAT_RET_QUEUE, LAT_FILL, LAT_COMPONENTS
+};
+
+enum LatencyType { LAT_IFETCH, LAT_LOAD, LAT_STORE, LAT_TYPES };
+
+#define LAT_BUCKETS 24 /* log2 histogram: bucket 0 = 0 cycles, k = [2^(k-1), 2^k) */
+
+/* DRAM side of a demand fill, in base cycles */
+struct FillTrace {
+    bool valid;
+    uint64_t enqueue;  /* Left the L2 request queue */
+    uint64_t complete; /* Returned by the DRAM controller */
+    uint64_t ret;      /* Left the L2 return queue (L2 MSHR completed) */
+    uint64_t bank_wait, bus_wait, bank, burst;
+
+    FillTrace() : valid(false), enqueue(0), complete(0), ret(0), bank_wait(0), bus_wait(0), bank(0), burst(0) {}
+};
+
+/* The miss an L1 is working on */
+struct MissTrace {
+    uint32_t block;
+    uint64_t first; /* Base cycle of the first attempt */
+    uint64_t last;  /* Core cycle of the latest attempt */
+    uint64_t issue; /* Base cycle the L1 MSHR was allocated */
+    MissPath path;
+    bool merged;    /* Secondary target of a pending L2 MSHR */
+    FillTrace fill;
+
+    MissTrace() : block(1), first(0), last(0), issue(0), path(MISS_L2), merged(false) {}
+};
+
+class LatencyProfiler {
+public:
+    LatencyProfiler();
+
+    /* A demand request (core_id >= 0) returned by the DRAM controller */
+    void dram_complete(const DRAM_Req& req, const ClockDomain& dram_clock);
+
+    /* The L2 MSHR of block completed: returns its DRAM trace (invalid if none) */
+    FillTrace take(uint32_t block);
+
+    /* An L1 of core_id filled the miss traced by t */
+    void record(int core_id, LatencyType type, const MissTrace& t);
+
+    /* Prints averages per core and request type, and histograms (rdump) */
+    void report() const;
+
+    uint64_t stat_misses[NUM_CORES][LAT_TYPES];
+    uint64_t stat_paths[NUM_CORES][LAT_TYPES][3]; /* By MissPath */
+    uint64_t stat_sum[NUM_CORES][LAT_TYPES][LAT_COMPONENTS]; /* Cycles per component */
+    uint64_t stat_hist[LAT_COMPONENTS + 1][LAT_BUCKETS]; /* Last row: total */
+
+private:
+    std::unordered_map<uint32_t, FillTrace> fills;
+};
+
+#endif
@@ -62,5 +62,7 @@
 #define OP_SB    0x28
 #define OP_SH    0x29
 #define OP_SW    0x2b
+#define OP_LL    0x30 /* load linked */
+#define OP_SC    0x38 /* store conditional */
 
 #endif
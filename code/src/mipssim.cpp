@@ -0,0 +1,317 @@
+#include "mipssim.h"
+#include "shell.h"
+#include "processor.h"
+#include "config.h"
+#include "console.h"
+#include "observer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/***************************************************************/
+/* Statistics.                                                 */
+/***************************************************************/
+
+uint32_t stat_cycles = 0, stat_inst_retire = 0, stat_inst_fetch = 0;
+uint32_t stat_squash = 0;
+
+/***************************************************************/
+/* Main memory.                                                */
+/***************************************************************/
+
+#define MEM_DATA_START  0x10000000
+#define MEM_DATA_SIZE   0x00100000
+#define MEM_TEXT_START  0x00400000
+#define MEM_TEXT_SIZE   0x00100000
+#define MEM_STACK_START 0x7ff00000
+#define MEM_STACK_SIZE  0x00100000
+#define MEM_KDATA_START 0x90000000
+#define MEM_KDATA_SIZE  0x00100000
+#define MEM_KTEXT_START 0x80000000
+#define MEM_KTEXT_SIZE  0x00100000
+
+struct mem_region_t {
+    uint32_t start, size;
+    std::vector<uint8_t> mem;
+
+    mem_region_t(uint32_t s, uint32_t sz) : start(s), size(sz), mem(sz, 0) {}
+};
+
+/* memory will be dynamically allocated at initialization */
+static std::vector<mem_region_t> MEM_REGIONS;
+
+static std::unique_ptr<Processor> P;
+
+/* The one live simulator (see mipssim.h) */
+struct mipssim {
+    std::vector<std::pair<std::string, uint64_t>> stats; /* Backs mipssim_stats names */
+};
+
+static mipssim_t* instance = nullptr;
+
+static bool live(mipssim_t* sim) {
+    return sim != nullptr && sim == instance;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure: mem_read_32                                      */
+/*                                                             */
+/* Purpose: Read a 32-bit word from memory                     */
+/*                                                             */
+/***************************************************************/
+uint32_t mem_read_32(uint32_t address)
+{
+    for (auto& region : MEM_REGIONS) {
+        if (address >= region.start && address < (region.start + region.size)) {
+            uint32_t offset = address - region.start;
+
+            return
+                (region.mem[offset+3] << 24) |
+                (region.mem[offset+2] << 16) |
+                (region.mem[offset+1] <<  8) |
+                (region.mem[offset+0] <<  0);
+        }
+    }
+
+    return 0;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure: mem_write_32                                     */
+/*                                                             */
+/* Purpose: Write a 32-bit word to memory                      */
+/*                                                             */
+/***************************************************************/
+void mem_write_32(uint32_t address, uint32_t value)
+{
+    for (auto& region : MEM_REGIONS) {
+        if (address >= region.start && address < (region.start + region.size)) {
+            uint32_t offset = address - region.start;
+
+            region.mem[offset+3] = (value >> 24) & 0xFF;
+            region.mem[offset+2] = (value >> 16) & 0xFF;
+            region.mem[offset+1] = (value >>  8) & 0xFF;
+            region.mem[offset+0] = (value >>  0) & 0xFF;
+            return;
+        }
+    }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : init_memory                                     */
+/*                                                             */
+/* Purpose   : Allocate and zero memoryy                       */
+/*                                                             */
+/***************************************************************/
+static void init_memory() {
+    MEM_REGIONS.clear();
+    MEM_REGIONS.emplace_back(MEM_TEXT_START, MEM_TEXT_SIZE);
+    MEM_REGIONS.emplace_back(MEM_DATA_START, MEM_DATA_SIZE);
+    MEM_REGIONS.emplace_back(MEM_STACK_START, MEM_STACK_SIZE);
+    MEM_REGIONS.emplace_back(MEM_KDATA_START, MEM_KDATA_SIZE);
+    MEM_REGIONS.emplace_back(MEM_KTEXT_START, MEM_KTEXT_SIZE);
+}
+
+mipssim_t* mipssim_create(void) {
+    if (instance)
+        return nullptr;
+
+    stat_cycles = stat_inst_retire = stat_inst_fetch = stat_squash = 0;
+    init_memory();
+    P = std::make_unique<Processor>();
+    instance = new mipssim;
+    return instance;
+}
+
+void mipssim_destroy(mipssim_t* sim) {
+    if (!live(sim))
+        return;
+
+    console.flush();
+    P->epochs.stop(*P);
+    P.reset();
+    MEM_REGIONS.clear();
+    MEM_REGIONS.shrink_to_fit();
+    delete instance;
+    instance = nullptr;
+}
+
+Processor* mipssim_processor(mipssim_t* sim) {
+    return live(sim) ? P.get() : nullptr;
+}
+
+int mipssim_load_program(mipssim_t* sim, const char* path) {
+    if (!live(sim))
+        return -1;
+
+    FILE* prog = fopen(path, "r");
+    if (prog == NULL)
+        return -1;
+
+    int ii = 0;
+    unsigned int word;
+    while (fscanf(prog, "%x\n", &word) != EOF) {
+        mem_write_32(MEM_TEXT_START + ii, word);
+        ii += 4;
+    }
+    fclose(prog);
+
+    /* Map the text pages on behalf of CPU 0 */
+    P->page_alloc.map_region(MEM_TEXT_START, ii, 0);
+
+    return ii / 4;
+}
+
+uint64_t mipssim_run(mipssim_t* sim, uint64_t cycles) {
+    if (!live(sim))
+        return 0;
+
+    uint64_t done = 0;
+    while (done < cycles && P->active_cores_count() > 0) {
+        P->cycle();
+        stat_cycles++;
+        done++;
+        P->epochs.tick(*P);
+        /* Jump over cycles where every core sleeps and memory is idle */
+        if (INTERVAL_CORE) {
+            uint64_t skipped = P->skip_idle(std::min(cycles - done, P->epochs.until_next()));
+            stat_cycles += skipped;
+            done += skipped;
+        }
+    }
+    if (P->active_cores_count() == 0) P->epochs.finish(*P);
+    console.flush();
+    return done;
+}
+
+uint64_t mipssim_run_until_halt(mipssim_t* sim, uint64_t max_cycles) {
+    return mipssim_run(sim, max_cycles ? max_cycles : UINT64_MAX);
+}
+
+int mipssim_halted(mipssim_t* sim) {
+    return !live(sim) || P->active_cores_count() == 0;
+}
+
+uint32_t mipssim_get_reg(mipssim_t* sim, int core, int reg) {
+    if (!live(sim) || core < 0 || core >= NUM_CORES)
+        return 0;
+
+    const Pipeline& pipe = *P->cores[core]->pipe;
+    if (reg >= 0 && reg < 32) return pipe.REGS[reg];
+    if (reg == MIPSSIM_REG_PC) return pipe.PC;
+    if (reg == MIPSSIM_REG_HI) return pipe.HI;
+    if (reg == MIPSSIM_REG_LO) return pipe.LO;
+    return 0;
+}
+
+int mipssim_set_reg(mipssim_t* sim, int core, int reg, uint32_t value) {
+    if (!live(sim) || core < 0 || core >= NUM_CORES)
+        return -1;
+
+    Pipeline& pipe = *P->cores[core]->pipe;
+    if (reg >= 0 && reg < 32) pipe.REGS[reg] = value;
+    else if (reg == MIPSSIM_REG_PC) pipe.PC = value;
+    else if (reg == MIPSSIM_REG_HI) pipe.HI = value;
+    else if (reg == MIPSSIM_REG_LO) pipe.LO = value;
+    else return -1;
+    return 0;
+}
+
+uint32_t mipssim_read_word(mipssim_t* sim, uint32_t addr) {
+    return live(sim) ? mem_read_32(addr) : 0;
+}
+
+void mipssim_write_word(mipssim_t* sim, uint32_t addr, uint32_t value) {
+    if (live(sim))
+        mem_write_32(addr, value);
+}
+
+int mipssim_load_plugin(mipssim_t* sim, const char* path) {
+    if (!live(sim) || !OBSERVER_ENABLE)
+        return -1;
+    return observers.load(path) ? 0 : -1;
+}
+
+int mipssim_set_epoch(mipssim_t* sim, uint64_t cycles, const char* path) {
+    if (!live(sim))
+        return -1;
+    if (cycles == 0) {
+        P->epochs.stop(*P);
+        return 0;
+    }
+    return P->epochs.start(*P, cycles, path) ? 0 : -1;
+}
+
+typedef std::vector<std::pair<std::string, uint64_t>> StatList;
+
+static void collect_stats(StatList& s) {
+    s.clear();
+    s.emplace_back("cycles", stat_cycles);
+    s.emplace_back("fetched_instr", stat_inst_fetch);
+    s.emplace_back("retired_instr", stat_inst_retire);
+    s.emplace_back("flushes", stat_squash);
+    s.emplace_back("skipped_cycles", P->stat_skipped_cycles);
+    s.emplace_back("roi_regions", P->stat_roi_regions);
+    s.emplace_back("roi_cycles", P->stat_roi_cycles);
+    s.emplace_back("roi_retired_instr", P->stat_roi_retire);
+    s.emplace_back("barriers", P->stat_barriers);
+
+    uint64_t writebacks = 0;
+    for (auto* l2 : P->l2s) writebacks += l2->stat_writebacks;
+    s.emplace_back("l2_writebacks", writebacks);
+
+    for (int k = 0; k < NUM_CORES; k++) {
+        const Core& c = *P->cores[k];
+        std::string core = "core" + std::to_string(k) + ".";
+        uint64_t l2_misses = 0;
+        for (auto* l2 : P->l2s) l2_misses += l2->stat_misses[k];
+
+        s.emplace_back(core + "running", c.is_running);
+        s.emplace_back(core + "cycles", c.clock.cycles);
+        s.emplace_back(core + "retired_instr", c.stat_inst_retire);
+        s.emplace_back(core + "functional_instr", c.stat_inst_functional);
+        s.emplace_back(core + "stall_cycles", c.stat_stall_cycles);
+        s.emplace_back(core + "l1i_misses", c.icache.stat_misses);
+        s.emplace_back(core + "l1d_misses", c.dcache.stat_misses);
+        s.emplace_back(core + "l2_misses", l2_misses);
+        s.emplace_back(core + "dram_requests", P->dram.stat_requests[k]);
+        s.emplace_back(core + "sc_successes", c.stat_sc_success);
+        s.emplace_back(core + "sc_failures", c.stat_sc_fail);
+        s.emplace_back(core + "barrier_wait_cycles", c.stat_barrier_cycles);
+    }
+}
+
+size_t mipssim_stats(mipssim_t* sim, mipssim_stat_t* out, size_t max) {
+    if (!live(sim))
+        return 0;
+
+    collect_stats(sim->stats);
+    for (size_t i = 0; i < max && i < sim->stats.size(); i++) {
+        out[i].name = sim->stats[i].first.c_str();
+        out[i].value = sim->stats[i].second;
+    }
+    return sim->stats.size();
+}
+
+int mipssim_stat(mipssim_t* sim, const char* name, uint64_t* value) {
+    if (!live(sim))
+        return 0;
+
+    StatList stats;
+    collect_stats(stats);
+    for (auto& s : stats) {
+        if (strcmp(s.first.c_str(), name) == 0) {
+            *value = s.second;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#ifndef _MIPSSIM_H_
+#define _MIPSSIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* libmipssim: the simulator as an embeddable library (make libmipssim.a).
+ * A host creates a simulator, loads a program, runs it for N cycles or
+ * until it halts, reads and writes registers and memory, and queries the
+ * statistics as name/value pairs, all in-process. The shell is a client of
+ * this API.
+ *
+ * The model keeps its state in process globals (memory, Processor,
+ * stat_cycles), so one simulator exists at a time: mipssim_create returns
+ * NULL while another is alive, and mipssim_destroy resets everything so the
+ * next create starts from a clean machine. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mipssim mipssim_t;
+
+/* Register ids for mipssim_get_reg / mipssim_set_reg: 0-31 are the GPRs */
+enum {
+    MIPSSIM_REG_PC = 32,
+    MIPSSIM_REG_HI = 33,
+    MIPSSIM_REG_LO = 34
+};
+
+typedef struct {
+    const char* name; /* Valid until the next mipssim_stats call or destroy */
+    uint64_t value;
+} mipssim_stat_t;
+
+mipssim_t* mipssim_create(void);
+void mipssim_destroy(mipssim_t* sim);
+
+/* Loads a hex program file (one word per line) at the text segment.
+ * Returns the number of words read, or -1 if the file cannot be opened. */
+int mipssim_load_program(mipssim_t* sim, const char* path);
+
+/* Simulates up to cycles base cycles, stopping early when every core has
+ * halted. Returns the base cycles simulated. */
+uint64_t mipssim_run(mipssim_t* sim, uint64_t cycles);
+
+/* Simulates until every core halts, or max_cycles base cycles have passed
+ * (0 = no limit). Returns the base cycles simulated. */
+uint64_t mipssim_run_until_halt(mipssim_t* sim, uint64_t max_cycles);
+
+/* Non-zero once no core is running */
+int mipssim_halted(mipssim_t* sim);
+
+/* Architectural state of a core; reads of an invalid core or register
+ * return 0, writes return -1 */
+uint32_t mipssim_get_reg(mipssim_t* sim, int core, int reg);
+int mipssim_set_reg(mipssim_t* sim, int core, int reg, uint32_t value);
+
+/* Functional (virtual) memory, word granularity. Unmapped addresses read 0
+ * and ignore writes. */
+uint32_t mipssim_read_word(mipssim_t* sim, uint32_t addr);
+void mipssim_write_word(mipssim_t* sim, uint32_t addr, uint32_t value);
+
+/* Fills out with up to max statistics and returns how many exist, so a
+ * call with max = 0 sizes the array. Names are "cycles", "retired_instr",
+ * ... for the machine and "core<N>.<stat>" per core. */
+size_t mipssim_stats(mipssim_t* sim, mipssim_stat_t* out, size_t max);
+
+/* Looks up one statistic by name; returns 0 if it does not exist */
+int mipssim_stat(mipssim_t* sim, const char* name, uint64_t* value);
+
+/* Loads an observer plugin (src/observer.h); needs OBSERVER_ENABLE.
+ * Observers stay registered for the life of the process. Returns 0, or -1
+ * on error. */
+int mipssim_load_plugin(mipssim_t* sim, const char* path);
+
+/* Writes an epoch time series (src/epoch.h) to path: one row of per-epoch
+ * statistics every cycles base cycles; path ending in ".bin" selects the
+ * binary format, anything else CSV. cycles = 0 ends the series. Returns 0,
+ * or -1 if the file cannot be created. */
+int mipssim_set_epoch(mipssim_t* sim, uint64_t cycles, const char* path);
+
+#ifdef __cplusplus
+}
+
+class Processor;
+
+/* C++ clients (the shell's detailed dump) can reach the model directly */
+Processor* mipssim_processor(mipssim_t* sim);
+#endif
+
+#endif
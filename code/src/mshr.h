@@ -4,6 +4,13 @@
 #include "config.h"
 #include <cstdint>
 
+// A request waiting on an L2 MSHR fill
+struct MSHR_Target {
+    int core_id;
+    bool is_icache;
+    bool is_write;
+};
+
 struct MSHR {
     bool valid;
     bool done;
@@ -12,11 +19,18 @@ struct MSHR {
     
     // Requester ID for callback
     int core_id;
+
+    // PC of the requesting instruction (dead-block prediction)
+    uint32_t pc;
     
     // Target MESI state for L1 Fill
     int target_state; // Cast to MESI_State logic
 
     uint64_t ready_cycle;
+
+    // L2: requests served by the fill (targets[0] is the primary miss)
+    MSHR_Target targets[L2_MSHR_TARGETS];
+    int num_targets;
 };
 
 #endif
@@ -0,0 +1,27 @@
+#include "observer.h"
+#include <cstdio>
+#include <dlfcn.h>
+
+ObserverHub observers;
+
+bool ObserverHub::load(const char* path) {
+    void* lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!lib) {
+        printf("plugin: %s\n", dlerror());
+        return false;
+    }
+
+    typedef SimObserver* (*CreateFn)();
+    CreateFn create = (CreateFn)dlsym(lib, "mipssim_observer_create");
+    SimObserver* o = create ? create() : nullptr;
+    if (!o) {
+        printf("plugin: %s has no mipssim_observer_create\n", path);
+        dlclose(lib);
+        return false;
+    }
+
+    // The library stays loaded for the life of the process
+    plugins.emplace_back(o);
+    add(o);
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef _OBSERVER_H_
+#define _OBSERVER_H_
+
+#include "config.h"
+#include "cache.h"
+#include "shell.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/* Observer hooks on pipeline and memory hierarchy events.
+ * Analyses subclass SimObserver, override the events they need, and are
+ * registered with observers.add() or loaded from a shared object exporting
+ *     extern "C" SimObserver* mipssim_observer_create();
+ * (shell "plugin <file.so>", mipssim_load_plugin). Call sites use
+ * OBSERVE(event, args...): with OBSERVER_ENABLE 0 the condition is a
+ * constant false and the hook compiles to nothing; with 1 it costs one
+ * branch while no observer is registered. Every event gets the base cycle
+ * first. Addresses are physical block or access addresses as seen by the
+ * caches; core is -1 for traffic with no requesting core (writebacks). */
+
+class SimObserver {
+public:
+    virtual ~SimObserver() {}
+
+    /* Pipeline (pc is virtual) */
+    virtual void on_fetch(uint64_t /*cycle*/, int /*core*/, uint32_t /*pc*/) {}
+    virtual void on_retire(uint64_t /*cycle*/, int /*core*/, uint32_t /*pc*/) {}
+
+    /* L1 caches */
+    virtual void on_l1_hit(uint64_t /*cycle*/, int /*core*/, bool /*icache*/, uint32_t /*addr*/, bool /*is_write*/) {}
+    virtual void on_l1_miss(uint64_t /*cycle*/, int /*core*/, bool /*icache*/, uint32_t /*addr*/, bool /*is_write*/) {}
+    virtual void on_l1_fill(uint64_t /*cycle*/, int /*core*/, bool /*icache*/, uint32_t /*addr*/, MESI_State /*state*/) {}
+    virtual void on_l1_evict(uint64_t /*cycle*/, int /*core*/, bool /*icache*/, uint32_t /*addr*/, bool /*dirty*/) {}
+    /* A requester's snoop of another core's L1 that found the line */
+    virtual void on_snoop(uint64_t /*cycle*/, int /*requester*/, int /*core*/, bool /*icache*/, uint32_t /*addr*/, bool /*is_write*/) {}
+    /* Any L1 MESI state change of a resident line */
+    virtual void on_coherence(uint64_t /*cycle*/, int /*core*/, bool /*icache*/, uint32_t /*addr*/, MESI_State /*from*/, MESI_State /*to*/) {}
+
+    /* L2 */
+    virtual void on_l2_mshr_alloc(uint64_t /*cycle*/, int /*core*/, uint32_t /*addr*/, bool /*is_write*/) {}
+    virtual void on_l2_mshr_complete(uint64_t /*cycle*/, int /*core*/, uint32_t /*addr*/) {}
+
+    /* DRAM (cycle is still the base cycle; the DRAM clock may differ) */
+    virtual void on_dram_enqueue(uint64_t /*cycle*/, int /*core*/, uint32_t /*addr*/, bool /*is_write*/) {}
+    virtual void on_dram_schedule(uint64_t /*cycle*/, int /*core*/, uint32_t /*addr*/, uint32_t /*bank*/, bool /*row_hit*/) {}
+    virtual void on_dram_complete(uint64_t /*cycle*/, int /*core*/, uint32_t /*addr*/) {}
+};
+
+class ObserverHub {
+public:
+    /* Registers an observer owned by the caller */
+    void add(SimObserver* o) { list.push_back(o); }
+
+    /* dlopens a plugin and registers the observer it creates; false on error */
+    bool load(const char* path);
+
+    bool active() const { return !list.empty(); }
+
+    template <typename... Params, typename... Args>
+    void each(void (SimObserver::*event)(Params...), Args... args) {
+        for (SimObserver* o : list) (o->*event)(args...);
+    }
+
+private:
+    std::vector<SimObserver*> list;
+    std::vector<std::unique_ptr<SimObserver>> plugins;
+};
+
+extern ObserverHub observers;
+
+#define OBSERVE(event, ...)                                                         \
+    do {                                                                            \
+        if (OBSERVER_ENABLE && observers.active())                                  \
+            observers.each(&SimObserver::event, (uint64_t)stat_cycles, __VA_ARGS__); \
+    } while (0)
+
+#endif
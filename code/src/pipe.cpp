@@ -10,6 +10,9 @@
 #include "shell.h"
 #include "mips.h"
 #include "core.h"
+#include "processor.h"
+#include "console.h"
+#include "observer.h"
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
@@ -20,19 +23,19 @@
 //#define DEBUG
 
 /* debug */
-void print_op(Pipe_Op *op)
+void print_op(int channel, Pipe_Op *op)
 {
     if (op)
-        printf("OP (PC=%08x inst=%08x) src1=R%d (%08x) src2=R%d (%08x) dst=R%d valid %d (%08x) br=%d taken=%d dest=%08x mem=%d addr=%08x\n",
+        console.print(channel, "OP (PC=%08x inst=%08x) src1=R%d (%08x) src2=R%d (%08x) dst=R%d valid %d (%08x) br=%d taken=%d dest=%08x mem=%d addr=%08x\n",
                 op->pc, op->instruction, op->reg_src1, op->reg_src1_value, op->reg_src2, op->reg_src2_value, op->reg_dst, op->reg_dst_value_ready,
                 op->reg_dst_value, op->is_branch, op->branch_taken, op->branch_dest, op->is_mem, op->mem_addr);
     else
-        printf("(null)\n");
+        console.print(channel, "(null)\n");
 }
 
 Pipeline::Pipeline(Core* c) : core(c), HI(0), LO(0), PC(0x00400000), 
                              branch_recover(0), branch_dest(0), branch_flush(0),
-                             multiplier_stall(0)
+                             multiplier_stall(0), cache_stall(false)
 {
     REGS.fill(0);
 }
@@ -52,196 +55,140 @@ void Pipeline::recover(int flush, uint32_t dest)
     branch_dest = dest;
 }
 
-void Pipeline::wb()
-{
-    /* if there is no instruction in this pipeline stage, we are done */
-    if (!wb_op)
-        return;
-
-    /* grab the op out of our input slot */
-    Pipe_Op *op = wb_op.get();
-
-    /* if this instruction writes a register, do so now */
-    if (op->reg_dst != -1 && op->reg_dst != 0) {
-        REGS[op->reg_dst] = op->reg_dst_value;
-#ifdef DEBUG
-        printf("[Core %d] R%d = %08x\n", core->id, op->reg_dst, op->reg_dst_value);
-#endif
-    }
+/* Instruction semantics shared by the pipeline stages and step_functional() */
 
-    /* internal: if this was a syscall, notify the core */
-    if (op->opcode == OP_SPECIAL && op->subop == SUBOP_SYSCALL) {
-        core->handle_syscall(op);
-    }
-
-    /* free the op */
-    wb_op.reset();
-
-    stat_inst_retire++;
-}
-
-void Pipeline::mem()
+void Pipeline::decode_fields(Pipe_Op *op)
 {
-    /* if there is no instruction in this pipeline stage, we are done */
-    if (!mem_op)
-        return;
+    /* set up info fields (source/dest regs, immediate, jump dest) as necessary */
+    uint32_t opcode = (op->instruction >> 26) & 0x3F;
+    uint32_t rs = (op->instruction >> 21) & 0x1F;
+    uint32_t rt = (op->instruction >> 16) & 0x1F;
+    uint32_t rd = (op->instruction >> 11) & 0x1F;
+    uint32_t shamt = (op->instruction >> 6) & 0x1F;
+    uint32_t funct2 = (op->instruction >> 0) & 0x3F;
+    uint32_t imm16 = (op->instruction >> 0) & 0xFFFF;
+    uint32_t se_imm16 = imm16 | ((imm16 & 0x8000) ? 0xFFFF8000 : 0);
+    uint32_t targ = (op->instruction & ((1UL << 26) - 1)) << 2;
 
-    /* grab the op out of our input slot */
-    Pipe_Op *op = mem_op.get();
+    op->opcode = opcode;
+    op->imm16 = imm16;
+    op->se_imm16 = se_imm16;
+    op->shamt = shamt;
 
-    /* Access D-Cache if this is a memory operation */
-    if (op->is_mem) {
-        bool is_write = op->mem_write; // You might need to verify if mem_write is set correctly in decode for all ops, but looking at decode() it seems so.
-        // wait, op->mem_write is set in decode for stores. For loads it is 0.
-        // Let's verify decode logic quickly in my head (or look at file). 
-        // Yes, `op->mem_write = 1` for stores, `0` for loads.
-        
-        if (!core->dcache.access(op->mem_addr, op->mem_write, true))
-            return;
-    }
+    switch (opcode) {
+        case OP_SPECIAL:
+            /* all "SPECIAL" insts are R-types that use the ALU and both source
+             * regs. Set up source regs and immediate value. */
+            op->reg_src1 = rs;
+            op->reg_src2 = rt;
+            op->reg_dst = rd;
+            op->subop = funct2;
+            if (funct2 == SUBOP_SYSCALL) {
+                op->reg_src1 = 2; // v0
+                op->reg_src2 = 3; // v1
+            }
+            if (funct2 == SUBOP_JR || funct2 == SUBOP_JALR) {
+                op->is_branch = 1;
+                op->branch_cond = 0;
+            }
 
-    uint32_t val = 0;
-    if (op->is_mem)
-        val = mem_read_32(op->mem_addr & ~3);
+            break;
 
-    switch (op->opcode) {
-        case OP_LW:
-        case OP_LH:
-        case OP_LHU:
-        case OP_LB:
-        case OP_LBU:
-            {
-                /* extract needed value */
+        case OP_BRSPEC:
+            /* branches that have -and-link variants come here */
+            op->is_branch = 1;
+            op->reg_src1 = rs;
+            op->reg_src2 = rt;
+            op->is_branch = 1;
+            op->branch_cond = 1; /* conditional branch */
+            op->branch_dest = op->pc + 4 + (se_imm16 << 2);
+            op->subop = rt;
+            if (rt == BROP_BLTZAL || rt == BROP_BGEZAL) {
+                /* link reg */
+                op->reg_dst = 31;
+                op->reg_dst_value = op->pc + 4;
                 op->reg_dst_value_ready = 1;
-                if (op->opcode == OP_LW) {
-                    op->reg_dst_value = val;
-                }
-                else if (op->opcode == OP_LH || op->opcode == OP_LHU) {
-                    if (op->mem_addr & 2)
-                        val = (val >> 16) & 0xFFFF;
-                    else
-                        val = val & 0xFFFF;
-
-                    if (op->opcode == OP_LH)
-                        val |= (val & 0x8000) ? 0xFFFF8000 : 0;
-
-                    op->reg_dst_value = val;
-                }
-                else if (op->opcode == OP_LB || op->opcode == OP_LBU) {
-                    switch (op->mem_addr & 3) {
-                        case 0:
-                            val = val & 0xFF;
-                            break;
-                        case 1:
-                            val = (val >> 8) & 0xFF;
-                            break;
-                        case 2:
-                            val = (val >> 16) & 0xFF;
-                            break;
-                        case 3:
-                            val = (val >> 24) & 0xFF;
-                            break;
-                    }
-
-                    if (op->opcode == OP_LB)
-                        val |= (val & 0x80) ? 0xFFFFFF80 : 0;
-
-                    op->reg_dst_value = val;
-                }
             }
             break;
 
-        case OP_SB:
-            switch (op->mem_addr & 3) {
-                case 0: val = (val & 0xFFFFFF00) | ((op->mem_value & 0xFF) << 0); break;
-                case 1: val = (val & 0xFFFF00FF) | ((op->mem_value & 0xFF) << 8); break;
-                case 2: val = (val & 0xFF00FFFF) | ((op->mem_value & 0xFF) << 16); break;
-                case 3: val = (val & 0x00FFFFFF) | ((op->mem_value & 0xFF) << 24); break;
-            }
+        case OP_JAL:
+            op->reg_dst = 31;
+            op->reg_dst_value = op->pc + 4;
+            op->reg_dst_value_ready = 1;
+            op->branch_taken = 1;
+            /* fallthrough */
+        case OP_J:
+            op->is_branch = 1;
+            op->branch_cond = 0;
+            op->branch_taken = 1;
+            op->branch_dest = (op->pc & 0xF0000000) | targ;
+            break;
 
-            mem_write_32(op->mem_addr & ~3, val);
+        case OP_BEQ:
+        case OP_BNE:
+        case OP_BLEZ:
+        case OP_BGTZ:
+            /* ordinary conditional branches (resolved after execute) */
+            op->is_branch = 1;
+            op->branch_cond = 1;
+            op->branch_dest = op->pc + 4 + (se_imm16 << 2);
+            op->reg_src1 = rs;
+            op->reg_src2 = rt;
             break;
 
-        case OP_SH:
-#ifdef DEBUG
-            printf("[Core %d] SH: addr %08x val %04x old word %08x\n", core->id, op->mem_addr, op->mem_value & 0xFFFF, val);
-#endif
-            if (op->mem_addr & 2)
-                val = (val & 0x0000FFFF) | (op->mem_value) << 16;
-            else
-                val = (val & 0xFFFF0000) | (op->mem_value & 0xFFFF);
-#ifdef DEBUG
-            printf("[Core %d] new word %08x\n", core->id, val);
-#endif
+        case OP_ADDI:
+        case OP_ADDIU:
+        case OP_SLTI:
+        case OP_SLTIU:
+            /* I-type ALU ops with sign-extended immediates */
+            op->reg_src1 = rs;
+            op->reg_dst = rt;
+            break;
 
-            mem_write_32(op->mem_addr & ~3, val);
+        case OP_ANDI:
+        case OP_ORI:
+        case OP_XORI:
+        case OP_LUI:
+            /* I-type ALU ops with non-sign-extended immediates */
+            op->reg_src1 = rs;
+            op->reg_dst = rt;
             break;
 
+        case OP_LW:
+        case OP_LH:
+        case OP_LHU:
+        case OP_LB:
+        case OP_LBU:
         case OP_SW:
-            val = op->mem_value;
-            mem_write_32(op->mem_addr & ~3, val);
+        case OP_SH:
+        case OP_SB:
+        case OP_LL:
+        case OP_SC:
+            /* memory ops */
+            op->is_mem = 1;
+            op->reg_src1 = rs;
+            if (opcode == OP_SC) {
+                /* store conditional: rt supplies the value and receives the result */
+                op->mem_write = 1;
+                op->reg_src2 = rt;
+                op->reg_dst = rt;
+            }
+            else if (opcode == OP_LW || opcode == OP_LH || opcode == OP_LHU || opcode == OP_LB || opcode == OP_LBU || opcode == OP_LL) {
+                /* load */
+                op->mem_write = 0;
+                op->reg_dst = rt;
+            }
+            else {
+                /* store */
+                op->mem_write = 1;
+                op->reg_src2 = rt;
+            }
             break;
     }
-
-    /* clear stage input and transfer to next stage */
-    wb_op = std::move(mem_op);
 }
 
-void Pipeline::execute()
+bool Pipeline::alu(Pipe_Op *op)
 {
-    /* if a multiply/divide is in progress, decrement cycles until value is ready */
-    if (multiplier_stall > 0)
-        multiplier_stall--;
-
-    /* if downstream stall, return (and leave any input we had) */
-    if (mem_op)
-        return;
-
-    /* if no op to execute, return */
-    if (!execute_op)
-        return;
-
-    /* grab op and read sources */
-    Pipe_Op *op = execute_op.get();
-
-    /* read register values, and check for bypass; stall if necessary */
-    int stall = 0;
-    if (op->reg_src1 != -1) {
-        if (op->reg_src1 == 0)
-            op->reg_src1_value = 0;
-        else if (mem_op && mem_op->reg_dst == op->reg_src1) {
-            if (!mem_op->reg_dst_value_ready)
-                stall = 1;
-            else
-                op->reg_src1_value = mem_op->reg_dst_value;
-        }
-        else if (wb_op && wb_op->reg_dst == op->reg_src1) {
-            op->reg_src1_value = wb_op->reg_dst_value;
-        }
-        else
-            op->reg_src1_value = REGS[op->reg_src1];
-    }
-    if (op->reg_src2 != -1) {
-        if (op->reg_src2 == 0)
-            op->reg_src2_value = 0;
-        else if (mem_op && mem_op->reg_dst == op->reg_src2) {
-            if (!mem_op->reg_dst_value_ready)
-                stall = 1;
-            else
-                op->reg_src2_value = mem_op->reg_dst_value;
-        }
-        else if (wb_op && wb_op->reg_dst == op->reg_src2) {
-            op->reg_src2_value = wb_op->reg_dst_value;
-        }
-        else
-            op->reg_src2_value = REGS[op->reg_src2];
-    }
-
-    /* if bypassing requires a stall (e.g. use immediately after load),
-     * return without clearing stage input */
-    if (stall) 
-        return;
-
     /* execute the op */
     switch (op->opcode) {
         case OP_SPECIAL:
@@ -338,14 +285,14 @@ void Pipeline::execute()
                 case SUBOP_MFHI:
                     /* stall until value is ready */
                     if (multiplier_stall > 0)
-                        return;
+                        return false;
 
                     op->reg_dst_value = HI;
                     break;
                 case SUBOP_MTHI:
                     /* stall to respect WAW dependence */
                     if (multiplier_stall > 0)
-                        return;
+                        return false;
 
                     HI = op->reg_src1_value;
                     break;
@@ -353,14 +300,14 @@ void Pipeline::execute()
                 case SUBOP_MFLO:
                     /* stall until value is ready */
                     if (multiplier_stall > 0)
-                        return;
+                        return false;
 
                     op->reg_dst_value = LO;
                     break;
                 case SUBOP_MTLO:
                     /* stall to respect WAW dependence */
                     if (multiplier_stall > 0)
-                        return;
+                        return false;
 
                     LO = op->reg_src1_value;
                     break;
@@ -395,82 +342,378 @@ void Pipeline::execute()
             }
             break;
 
-        case OP_BRSPEC:
-            switch (op->subop) {
-                case BROP_BLTZ:
-                case BROP_BLTZAL:
-                    if ((int32_t)op->reg_src1_value < 0) op->branch_taken = 1;
-                    break;
+        case OP_BRSPEC:
+            switch (op->subop) {
+                case BROP_BLTZ:
+                case BROP_BLTZAL:
+                    if ((int32_t)op->reg_src1_value < 0) op->branch_taken = 1;
+                    break;
+
+                case BROP_BGEZ:
+                case BROP_BGEZAL:
+                    if ((int32_t)op->reg_src1_value >= 0) op->branch_taken = 1;
+                    break;
+            }
+            break;
+
+        case OP_BEQ:
+            if (op->reg_src1_value == op->reg_src2_value) op->branch_taken = 1;
+            break;
+
+        case OP_BNE:
+            if (op->reg_src1_value != op->reg_src2_value) op->branch_taken = 1;
+            break;
+
+        case OP_BLEZ:
+            if ((int32_t)op->reg_src1_value <= 0) op->branch_taken = 1;
+            break;
+
+        case OP_BGTZ:
+            if ((int32_t)op->reg_src1_value > 0) op->branch_taken = 1;
+            break;
+
+        case OP_ADDI:
+        case OP_ADDIU:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->reg_src1_value + op->se_imm16;
+            break;
+        case OP_SLTI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = (int32_t)op->reg_src1_value < (int32_t)op->se_imm16 ? 1 : 0;
+            break;
+        case OP_SLTIU:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = (uint32_t)op->reg_src1_value < (uint32_t)op->se_imm16 ? 1 : 0;
+            break;
+        case OP_ANDI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->reg_src1_value & op->imm16;
+            break;
+        case OP_ORI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->reg_src1_value | op->imm16;
+            break;
+        case OP_XORI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->reg_src1_value ^ op->imm16;
+            break;
+        case OP_LUI:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = op->imm16 << 16;
+            break;
+
+        case OP_LW:
+        case OP_LH:
+        case OP_LHU:
+        case OP_LB:
+        case OP_LBU:
+        case OP_LL:
+            op->mem_addr = op->reg_src1_value + op->se_imm16;
+            break;
+
+        case OP_SW:
+        case OP_SH:
+        case OP_SB:
+        case OP_SC:
+            op->mem_addr = op->reg_src1_value + op->se_imm16;
+            op->mem_value = op->reg_src2_value;
+            break;
+    }
+
+    return true;
+}
+
+void Pipeline::mem_data(Pipe_Op *op)
+{
+    uint32_t val = 0;
+    if (op->is_mem)
+        val = mem_read_32(op->mem_addr & ~3);
+
+    /* a failed SC writes nothing */
+    bool writes = op->mem_write &&
+        (op->opcode != OP_SC || core->has_link(core->translate(op->mem_addr)));
+
+    /* without coherence snoops (or before them, in the interval model),
+     * functional stores break other cores' links directly */
+    if (writes && (core->functional || INTERVAL_CORE))
+        core->proc->clear_links(core->translate(op->mem_addr), core);
+
+    /* stores to translated code drop the translation */
+    if (writes && DBT_ENABLE)
+        core->proc->dbt.note_store(op->mem_addr);
+
+    switch (op->opcode) {
+        case OP_LL:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = val;
+            core->set_link(core->translate(op->mem_addr));
+            break;
+
+        case OP_SC:
+            op->reg_dst_value_ready = 1;
+            op->reg_dst_value = core->has_link(core->translate(op->mem_addr)) ? 1 : 0;
+            if (op->reg_dst_value) {
+                mem_write_32(op->mem_addr & ~3, op->mem_value);
+                core->stat_sc_success++;
+            } else {
+                core->stat_sc_fail++;
+            }
+            core->ll_valid = false;
+            break;
+
+        case OP_LW:
+        case OP_LH:
+        case OP_LHU:
+        case OP_LB:
+        case OP_LBU:
+            {
+                /* extract needed value */
+                op->reg_dst_value_ready = 1;
+                if (op->opcode == OP_LW) {
+                    op->reg_dst_value = val;
+                }
+                else if (op->opcode == OP_LH || op->opcode == OP_LHU) {
+                    if (op->mem_addr & 2)
+                        val = (val >> 16) & 0xFFFF;
+                    else
+                        val = val & 0xFFFF;
+
+                    if (op->opcode == OP_LH)
+                        val |= (val & 0x8000) ? 0xFFFF8000 : 0;
+
+                    op->reg_dst_value = val;
+                }
+                else if (op->opcode == OP_LB || op->opcode == OP_LBU) {
+                    switch (op->mem_addr & 3) {
+                        case 0:
+                            val = val & 0xFF;
+                            break;
+                        case 1:
+                            val = (val >> 8) & 0xFF;
+                            break;
+                        case 2:
+                            val = (val >> 16) & 0xFF;
+                            break;
+                        case 3:
+                            val = (val >> 24) & 0xFF;
+                            break;
+                    }
+
+                    if (op->opcode == OP_LB)
+                        val |= (val & 0x80) ? 0xFFFFFF80 : 0;
+
+                    op->reg_dst_value = val;
+                }
+            }
+            break;
+
+        case OP_SB:
+            switch (op->mem_addr & 3) {
+                case 0: val = (val & 0xFFFFFF00) | ((op->mem_value & 0xFF) << 0); break;
+                case 1: val = (val & 0xFFFF00FF) | ((op->mem_value & 0xFF) << 8); break;
+                case 2: val = (val & 0xFF00FFFF) | ((op->mem_value & 0xFF) << 16); break;
+                case 3: val = (val & 0x00FFFFFF) | ((op->mem_value & 0xFF) << 24); break;
+            }
+
+            mem_write_32(op->mem_addr & ~3, val);
+            break;
+
+        case OP_SH:
+#ifdef DEBUG
+            console.print(core->id, "[Core %d] SH: addr %08x val %04x old word %08x\n", core->id, op->mem_addr, op->mem_value & 0xFFFF, val);
+#endif
+            if (op->mem_addr & 2)
+                val = (val & 0x0000FFFF) | (op->mem_value) << 16;
+            else
+                val = (val & 0xFFFF0000) | (op->mem_value & 0xFFFF);
+#ifdef DEBUG
+            console.print(core->id, "[Core %d] new word %08x\n", core->id, val);
+#endif
+
+            mem_write_32(op->mem_addr & ~3, val);
+            break;
+
+        case OP_SW:
+            val = op->mem_value;
+            mem_write_32(op->mem_addr & ~3, val);
+            break;
+    }
+}
+
+void Pipeline::step_functional(Pipe_Op* done)
+{
+    /* one instruction, architecturally, with no cache or pipeline timing
+     * (the interval model charges timing from the executed op in done) */
+    Pipe_Op op;
+    op.instruction = mem_read_32(PC);
+    op.pc = PC;
+    decode_fields(&op);
+
+    if (op.reg_src1 > 0) op.reg_src1_value = REGS[op.reg_src1];
+    if (op.reg_src2 > 0) op.reg_src2_value = REGS[op.reg_src2];
+
+    multiplier_stall = 0;
+    alu(&op);
+
+    if ((FUNCTIONAL_WARM || SMARTS_ENABLE) && core->functional) {
+        core->warm(op.pc, false, true);
+        if (op.is_mem)
+            core->warm(op.mem_addr, op.mem_write, false);
+    }
+    if (op.is_mem)
+        mem_data(&op);
+
+    if (op.reg_dst != -1 && op.reg_dst != 0)
+        REGS[op.reg_dst] = op.reg_dst_value;
+
+    PC = op.branch_taken ? op.branch_dest : op.pc + 4;
+
+    if (op.opcode == OP_SPECIAL && op.subop == SUBOP_SYSCALL)
+        core->handle_syscall(&op);
+
+    if (done)
+        *done = op;
+
+    if (core->functional) {
+        core->stat_inst_functional++;
+    } else {
+        /* interval model: a timed instruction */
+        OBSERVE(on_fetch, core->id, op.pc);
+        OBSERVE(on_retire, core->id, op.pc);
+        stat_inst_fetch++;
+        stat_inst_retire++;
+        core->stat_inst_retire++;
+    }
+}
+
+bool Pipeline::empty() const
+{
+    return !decode_op && !execute_op && !mem_op && !wb_op && !branch_recover;
+}
+
+void Pipeline::wb()
+{
+    /* if there is no instruction in this pipeline stage, we are done */
+    if (!wb_op)
+        return;
+
+    /* grab the op out of our input slot */
+    Pipe_Op *op = wb_op.get();
+
+    /* if this instruction writes a register, do so now */
+    if (op->reg_dst != -1 && op->reg_dst != 0) {
+        REGS[op->reg_dst] = op->reg_dst_value;
+#ifdef DEBUG
+        console.print(core->id, "[Core %d] R%d = %08x\n", core->id, op->reg_dst, op->reg_dst_value);
+#endif
+    }
+
+    /* internal: if this was a syscall, notify the core */
+    if (op->opcode == OP_SPECIAL && op->subop == SUBOP_SYSCALL) {
+        core->handle_syscall(op);
+    }
+
+    OBSERVE(on_retire, core->id, op->pc);
+
+    /* free the op */
+    wb_op.reset();
+
+    stat_inst_retire++;
+    core->stat_inst_retire++;
+}
+
+void Pipeline::mem()
+{
+    /* if there is no instruction in this pipeline stage, we are done */
+    if (!mem_op)
+        return;
 
-                case BROP_BGEZ:
-                case BROP_BGEZAL:
-                    if ((int32_t)op->reg_src1_value >= 0) op->branch_taken = 1;
-                    break;
-            }
-            break;
+    /* grab the op out of our input slot */
+    Pipe_Op *op = mem_op.get();
 
-        case OP_BEQ:
-            if (op->reg_src1_value == op->reg_src2_value) op->branch_taken = 1;
-            break;
+    /* Access D-Cache if this is a memory operation */
+    /* a store conditional whose link is already broken fails without a bus write */
+    bool doomed_sc = op->opcode == OP_SC && !core->has_link(core->translate(op->mem_addr));
 
-        case OP_BNE:
-            if (op->reg_src1_value != op->reg_src2_value) op->branch_taken = 1;
-            break;
+    if (op->is_mem && !doomed_sc) {
+        bool is_write = op->mem_write; // You might need to verify if mem_write is set correctly in decode for all ops, but looking at decode() it seems so.
+        // wait, op->mem_write is set in decode for stores. For loads it is 0.
+        // Let's verify decode logic quickly in my head (or look at file). 
+        // Yes, `op->mem_write = 1` for stores, `0` for loads.
+        
+        if (!core->dcache.access(core->translate(op->mem_addr), op->mem_write, true, op->pc)) {
+            cache_stall = true;
+            return;
+        }
+        if (RD_PROFILE) core->proc->reuse.access_l1d(core->id, core->translate(op->mem_addr));
+        if (FALSE_SHARING_DETECT) core->proc->sharing.access(core->id, core->translate(op->mem_addr), op->mem_write);
+    }
 
-        case OP_BLEZ:
-            if ((int32_t)op->reg_src1_value <= 0) op->branch_taken = 1;
-            break;
+    mem_data(op);
 
-        case OP_BGTZ:
-            if ((int32_t)op->reg_src1_value > 0) op->branch_taken = 1;
-            break;
+    /* clear stage input and transfer to next stage */
+    wb_op = std::move(mem_op);
+}
 
-        case OP_ADDI:
-        case OP_ADDIU:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->reg_src1_value + op->se_imm16;
-            break;
-        case OP_SLTI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = (int32_t)op->reg_src1_value < (int32_t)op->se_imm16 ? 1 : 0;
-            break;
-        case OP_SLTIU:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = (uint32_t)op->reg_src1_value < (uint32_t)op->se_imm16 ? 1 : 0;
-            break;
-        case OP_ANDI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->reg_src1_value & op->imm16;
-            break;
-        case OP_ORI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->reg_src1_value | op->imm16;
-            break;
-        case OP_XORI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->reg_src1_value ^ op->imm16;
-            break;
-        case OP_LUI:
-            op->reg_dst_value_ready = 1;
-            op->reg_dst_value = op->imm16 << 16;
-            break;
+void Pipeline::execute()
+{
+    /* if a multiply/divide is in progress, decrement cycles until value is ready */
+    if (multiplier_stall > 0)
+        multiplier_stall--;
 
-        case OP_LW:
-        case OP_LH:
-        case OP_LHU:
-        case OP_LB:
-        case OP_LBU:
-            op->mem_addr = op->reg_src1_value + op->se_imm16;
-            break;
+    /* if downstream stall, return (and leave any input we had) */
+    if (mem_op)
+        return;
 
-        case OP_SW:
-        case OP_SH:
-        case OP_SB:
-            op->mem_addr = op->reg_src1_value + op->se_imm16;
-            op->mem_value = op->reg_src2_value;
-            break;
+    /* if no op to execute, return */
+    if (!execute_op)
+        return;
+
+    /* grab op and read sources */
+    Pipe_Op *op = execute_op.get();
+
+    /* read register values, and check for bypass; stall if necessary */
+    int stall = 0;
+    if (op->reg_src1 != -1) {
+        if (op->reg_src1 == 0)
+            op->reg_src1_value = 0;
+        else if (mem_op && mem_op->reg_dst == op->reg_src1) {
+            if (!mem_op->reg_dst_value_ready)
+                stall = 1;
+            else
+                op->reg_src1_value = mem_op->reg_dst_value;
+        }
+        else if (wb_op && wb_op->reg_dst == op->reg_src1) {
+            op->reg_src1_value = wb_op->reg_dst_value;
+        }
+        else
+            op->reg_src1_value = REGS[op->reg_src1];
+    }
+    if (op->reg_src2 != -1) {
+        if (op->reg_src2 == 0)
+            op->reg_src2_value = 0;
+        else if (mem_op && mem_op->reg_dst == op->reg_src2) {
+            if (!mem_op->reg_dst_value_ready)
+                stall = 1;
+            else
+                op->reg_src2_value = mem_op->reg_dst_value;
+        }
+        else if (wb_op && wb_op->reg_dst == op->reg_src2) {
+            op->reg_src2_value = wb_op->reg_dst_value;
+        }
+        else
+            op->reg_src2_value = REGS[op->reg_src2];
     }
 
+    /* if bypassing requires a stall (e.g. use immediately after load),
+     * return without clearing stage input */
+    if (stall) 
+        return;
+
+    /* execute the op; MFHI/MFLO/MTHI/MTLO wait for the multiplier */
+    if (!alu(op))
+        return;
+
     /* handle branch recoveries at this point */
     if (op->branch_taken)
         recover(3, op->branch_dest);
@@ -513,125 +756,7 @@ void Pipeline::decode()
     /* grab op and remove from stage input */
     Pipe_Op *op = decode_op.get();
 
-    /* set up info fields (source/dest regs, immediate, jump dest) as necessary */
-    uint32_t opcode = (op->instruction >> 26) & 0x3F;
-    uint32_t rs = (op->instruction >> 21) & 0x1F;
-    uint32_t rt = (op->instruction >> 16) & 0x1F;
-    uint32_t rd = (op->instruction >> 11) & 0x1F;
-    uint32_t shamt = (op->instruction >> 6) & 0x1F;
-    uint32_t funct1 = (op->instruction >> 0) & 0x1F;
-    uint32_t funct2 = (op->instruction >> 0) & 0x3F;
-    uint32_t imm16 = (op->instruction >> 0) & 0xFFFF;
-    uint32_t se_imm16 = imm16 | ((imm16 & 0x8000) ? 0xFFFF8000 : 0);
-    uint32_t targ = (op->instruction & ((1UL << 26) - 1)) << 2;
-
-    op->opcode = opcode;
-    op->imm16 = imm16;
-    op->se_imm16 = se_imm16;
-    op->shamt = shamt;
-
-    switch (opcode) {
-        case OP_SPECIAL:
-            /* all "SPECIAL" insts are R-types that use the ALU and both source
-             * regs. Set up source regs and immediate value. */
-            op->reg_src1 = rs;
-            op->reg_src2 = rt;
-            op->reg_dst = rd;
-            op->subop = funct2;
-            if (funct2 == SUBOP_SYSCALL) {
-                op->reg_src1 = 2; // v0
-                op->reg_src2 = 3; // v1
-            }
-            if (funct2 == SUBOP_JR || funct2 == SUBOP_JALR) {
-                op->is_branch = 1;
-                op->branch_cond = 0;
-            }
-
-            break;
-
-        case OP_BRSPEC:
-            /* branches that have -and-link variants come here */
-            op->is_branch = 1;
-            op->reg_src1 = rs;
-            op->reg_src2 = rt;
-            op->is_branch = 1;
-            op->branch_cond = 1; /* conditional branch */
-            op->branch_dest = op->pc + 4 + (se_imm16 << 2);
-            op->subop = rt;
-            if (rt == BROP_BLTZAL || rt == BROP_BGEZAL) {
-                /* link reg */
-                op->reg_dst = 31;
-                op->reg_dst_value = op->pc + 4;
-                op->reg_dst_value_ready = 1;
-            }
-            break;
-
-        case OP_JAL:
-            op->reg_dst = 31;
-            op->reg_dst_value = op->pc + 4;
-            op->reg_dst_value_ready = 1;
-            op->branch_taken = 1;
-            /* fallthrough */
-        case OP_J:
-            op->is_branch = 1;
-            op->branch_cond = 0;
-            op->branch_taken = 1;
-            op->branch_dest = (op->pc & 0xF0000000) | targ;
-            break;
-
-        case OP_BEQ:
-        case OP_BNE:
-        case OP_BLEZ:
-        case OP_BGTZ:
-            /* ordinary conditional branches (resolved after execute) */
-            op->is_branch = 1;
-            op->branch_cond = 1;
-            op->branch_dest = op->pc + 4 + (se_imm16 << 2);
-            op->reg_src1 = rs;
-            op->reg_src2 = rt;
-            break;
-
-        case OP_ADDI:
-        case OP_ADDIU:
-        case OP_SLTI:
-        case OP_SLTIU:
-            /* I-type ALU ops with sign-extended immediates */
-            op->reg_src1 = rs;
-            op->reg_dst = rt;
-            break;
-
-        case OP_ANDI:
-        case OP_ORI:
-        case OP_XORI:
-        case OP_LUI:
-            /* I-type ALU ops with non-sign-extended immediates */
-            op->reg_src1 = rs;
-            op->reg_dst = rt;
-            break;
-
-        case OP_LW:
-        case OP_LH:
-        case OP_LHU:
-        case OP_LB:
-        case OP_LBU:
-        case OP_SW:
-        case OP_SH:
-        case OP_SB:
-            /* memory ops */
-            op->is_mem = 1;
-            op->reg_src1 = rs;
-            if (opcode == OP_LW || opcode == OP_LH || opcode == OP_LHU || opcode == OP_LB || opcode == OP_LBU) {
-                /* load */
-                op->mem_write = 0;
-                op->reg_dst = rt;
-            }
-            else {
-                /* store */
-                op->mem_write = 1;
-                op->reg_src2 = rt;
-            }
-            break;
-    }
+    decode_fields(op);
 
     /* we will handle reg-read together with bypass in the execute stage */
 
@@ -646,8 +771,10 @@ void Pipeline::fetch()
         return;
 
     /* Check I-Cache */
-    if (!core->icache.access(PC, false, false))
+    if (!core->icache.access(core->translate(PC), false, false, PC)) {
+        cache_stall = true;
         return;
+    }
 
     /* Allocate an op and send it down the pipeline. */
     auto op = std::make_unique<Pipe_Op>();
@@ -655,6 +782,7 @@ void Pipeline::fetch()
     op->instruction = mem_read_32(PC);
     op->pc = PC;
     decode_op = std::move(op);
+    OBSERVE(on_fetch, core->id, PC);
 
     /* update PC */
     PC += 4;
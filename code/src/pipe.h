@@ -106,6 +106,9 @@ public:
     /* multiplier stall info */
     int multiplier_stall; /* number of remaining cycles until HI/LO are ready */
 
+    /* set when fetch or mem waits on an L1 miss this cycle */
+    bool cache_stall;
+
     /* Helper for branch recovery */
     void recover(int flush, uint32_t dest);
 
@@ -115,9 +118,20 @@ public:
     void execute();
     void mem();
     void wb();
+
+    /* Instruction semantics, shared with the functional executor */
+    static void decode_fields(Pipe_Op *op);
+    bool alu(Pipe_Op *op); /* false while waiting on the multiplier */
+    void mem_data(Pipe_Op *op);
+
+    /* Executes the instruction at PC without timing (ROI fast-forward) */
+    void step_functional(Pipe_Op* done = nullptr);
+
+    /* No instruction in flight and no recovery pending */
+    bool empty() const;
 };
 
 /* debug */
-void print_op(Pipe_Op *op);
+void print_op(int channel, Pipe_Op *op);
 
 #endif
@@ -8,35 +8,193 @@
 
 #include "processor.h"
 #include "config.h"
+#include "console.h"
+#include <algorithm>
+
+Processor::Processor() : page_alloc(&dram), fst(this), smarts(this), stat_skipped_cycles(0),
+                         roi_depth(0), roi_begin_cycle(0), roi_begin_retire(0),
+                         stat_roi_cycles(0), stat_roi_retire(0), stat_roi_regions(0),
+                         barrier_arrived(0), barrier_participants(0), stat_barriers(0) {
+    if (L2_PRIVATE) {
+        for (int i = 0; i < NUM_CORES; i++) {
+            l2_caches.push_back(std::make_unique<L2Cache>(&dram, L2_PRIVATE_SIZE / (L2_ASSOC * BLOCK_SIZE)));
+        }
+    } else {
+        l2_caches.push_back(std::make_unique<L2Cache>(&dram));
+    }
+    for (auto& l2 : l2_caches) l2s.push_back(l2.get());
 
-Processor::Processor() : l2_cache(&dram) {
     /* Initialize NUM_CORES Cores */
     for (int i = 0; i < NUM_CORES; i++) {
-        cores.push_back(std::make_unique<Core>(i, this, &l2_cache));
+        cores.push_back(std::make_unique<Core>(i, this, l2_of(i)));
+    }
+
+    if (FUNCTIONAL_WARM || SMARTS_ENABLE) {
+        dbt.warm = [](Core* core, uint32_t vaddr, bool is_write, bool is_fetch) {
+            core->warm(vaddr, is_write, is_fetch);
+        };
     }
 }
 
 extern uint32_t stat_cycles;
 extern uint32_t mem_read_32(uint32_t address); // From shell.cpp
 
+void Processor::roi_begin(Core* core) {
+    if (ROI_PER_CORE) {
+        if (core->roi_active) return;
+        core->roi_active = true;
+        core->roi_begin_cycle = core->clock.cycles;
+        core->roi_begin_retire = core->stat_inst_retire;
+        core->set_functional(false);
+        return;
+    }
+
+    if (roi_depth++ > 0) return;
+    roi_begin_cycle = stat_cycles;
+    roi_begin_retire = stat_inst_retire;
+    for (auto& c : cores) c->set_functional(false);
+
+#ifdef DEBUG
+    console.print(core->id, "[ROI] Begin at cycle %u (core %d)\n", stat_cycles, core->id);
+#endif
+}
+
+void Processor::roi_end(Core* core) {
+    if (ROI_PER_CORE) {
+        if (!core->roi_active) return;
+        core->roi_active = false;
+        core->stat_roi_cycles += core->clock.cycles - core->roi_begin_cycle;
+        core->stat_roi_retire += core->stat_inst_retire - core->roi_begin_retire;
+        if (ROI_FAST_FORWARD) core->set_functional(true);
+        stat_roi_regions++;
+        return;
+    }
+
+    if (roi_depth == 0 || --roi_depth > 0) return;
+    stat_roi_cycles += stat_cycles - roi_begin_cycle;
+    stat_roi_retire += stat_inst_retire - roi_begin_retire;
+    stat_roi_regions++;
+    if (ROI_FAST_FORWARD) {
+        for (auto& c : cores) c->set_functional(true);
+    }
+
+#ifdef DEBUG
+    console.print(core->id, "[ROI] End at cycle %u (core %d)\n", stat_cycles, core->id);
+#endif
+}
+
 void Processor::cycle() {
     /* 1. Drive Memory Hierarchy */
     // L2 access is demand-driven by Cores (in core->cycle), but DRAM is autonomous.
-    DRAM_Req completed_req = dram.execute(stat_cycles);
+    // Each component only advances on an edge of its own clock domain.
+    // All domains are ticked first so every component sees this cycle's time.
+    bool dram_edge = dram.clock.tick();
+    bool uncore_edge[NUM_CORES] = {}; // One per L2 (at most NUM_CORES)
+    for (size_t i = 0; i < l2s.size(); i++) {
+        uncore_edge[i] = l2s[i]->clock.tick();
+    }
+    bool core_edge[NUM_CORES];
+    for (int i = 0; i < NUM_CORES; i++) {
+        core_edge[i] = cores[i]->clock.tick();
+    }
+
+    if (dram_edge) {
+        DRAM_Req completed_req = dram.execute(dram.clock.cycles);
     
-    if (completed_req.valid) {
-        // Data returned from Memory
-        // Queue into L2 Return Queue (5 cycle delay)
-        l2_cache.handle_dram_completion(completed_req.addr);
-        // Note: L1 update happens after L2 delay in complete_mshr
+        if (completed_req.valid) {
+            if (MISS_LATENCY_PROFILE) latency.dram_complete(completed_req, dram.clock);
+            // Data returned from Memory
+            // Queue into L2 Return Queue (5 cycle delay)
+            // Private L2s: only the requester's L2 waits on it (writebacks need no completion)
+            if (!L2_PRIVATE) {
+                l2s[0]->handle_dram_completion(completed_req.addr);
+            } else if (completed_req.core_id >= 0 && completed_req.core_id < NUM_CORES) {
+                l2s[completed_req.core_id]->handle_dram_completion(completed_req.addr);
+            }
+            // Note: L1 update happens after L2 delay in complete_mshr
+        }
     }
 
     // Drive L2 Cache Timing
-    l2_cache.cycle(stat_cycles, cores);
+    for (size_t i = 0; i < l2s.size(); i++) {
+        if (uncore_edge[i]) {
+            l2s[i]->cycle(l2s[i]->clock.cycles, cores);
+        }
+    }
 
     /* 2. Tick all cores */
     for (int i = 0; i < NUM_CORES; i++) {
-        cores[i]->cycle();
+        if (core_edge[i]) {
+            cores[i]->cycle();
+        }
+    }
+
+    /* 3. Source throttling decisions */
+    if (FST_ENABLE) {
+        fst.cycle(stat_cycles);
+    }
+
+    /* 4. Sampling phase changes */
+    if (SMARTS_ENABLE) {
+        smarts.cycle();
+    }
+}
+
+uint64_t Processor::skip_idle(uint64_t limit) {
+    if (FST_ENABLE || SMARTS_ENABLE || !dram.active_requests.empty()) return 0;
+    for (auto* l2 : l2s) {
+        if (!l2->req_queue.empty() || !l2->ret_queue.empty()) return 0;
+    }
+
+    uint64_t n = limit;
+    bool running = false;
+    for (auto& c : cores) {
+        if (!c->is_running) continue;
+        running = true;
+        if (c->functional || c->interval_pending || c->barrier_wait || c->clock.freq_mhz != CLOCK_FREQ_MHZ) return 0;
+        // The core's next call is on the edge that reaches interval_ready
+        if (c->interval_ready <= c->clock.cycles + 1) return 0;
+        n = std::min(n, c->interval_ready - c->clock.cycles - 1);
+    }
+    if (!running) return 0;
+
+    dram.clock.advance(n);
+    for (auto* l2 : l2s) l2->clock.advance(n);
+    for (auto& c : cores) c->clock.advance(n);
+    stat_skipped_cycles += n;
+    return n;
+}
+
+void Processor::barrier_arrive(Core* core, uint32_t participants) {
+    if (barrier_arrived == 0) barrier_participants = participants;
+    core->barrier_wait = true;
+    core->barrier_release = UINT64_MAX;
+    barrier_arrived++;
+    barrier_open();
+}
+
+void Processor::barrier_open() {
+    if (barrier_arrived == 0) return;
+
+    // Re-evaluated on every arrival, spawn and halt: cores forked after the
+    // first arrival take part, halted ones are no longer awaited
+    uint32_t running = active_cores_count();
+    uint32_t target = (barrier_participants && barrier_participants < running) ? barrier_participants : running;
+    if ((uint32_t)barrier_arrived < target) return;
+
+#ifdef DEBUG
+    console.print(CONSOLE_SYSTEM, "[Barrier] %d cores released at cycle %u\n", barrier_arrived, stat_cycles + BARRIER_LATENCY);
+#endif
+    for (auto& c : cores) {
+        if (c->barrier_wait) c->barrier_release = stat_cycles + BARRIER_LATENCY;
+    }
+    barrier_arrived = 0;
+    stat_barriers++;
+}
+
+void Processor::clear_links(uint32_t paddr, const Core* writer) {
+    for (auto& c : cores) {
+        if (c.get() != writer) c->clear_link(paddr);
     }
 }
 
@@ -12,6 +12,14 @@
 #include "core.h"
 #include "cache.h"
 #include "dram.h"
+#include "vmem.h"
+#include "fst.h"
+#include "dbt.h"
+#include "smarts.h"
+#include "reuse.h"
+#include "sharing.h"
+#include "latency.h"
+#include "epoch.h"
 #include <vector>
 #include <memory>
 
@@ -23,12 +31,74 @@ public:
     std::vector<std::unique_ptr<Core>> cores;
     
     /* Shared Memory Hierarchy */
-    L2Cache l2_cache;
     DRAM dram;
 
+    /* The shared L2, or the private per-core L2s (L2_PRIVATE) in core order */
+    std::vector<std::unique_ptr<L2Cache>> l2_caches;
+
+    /* Every active L2 (the pointers of l2_caches) */
+    std::vector<L2Cache*> l2s;
+
+    /* Virtual-to-physical page mapping (shared address space) */
+    PageAllocator page_alloc;
+
+    /* Fairness via source throttling */
+    FSTController fst;
+
+    /* Translated functional execution (DBT_ENABLE) */
+    BlockTranslator dbt;
+
+    /* Statistical sampling (SMARTS_ENABLE) */
+    SmartsSampler smarts;
+
+    /* Stack-distance profiles (RD_PROFILE) */
+    ReuseProfiler reuse;
+
+    /* Per-line coherence traffic and word footprints (FALSE_SHARING_DETECT) */
+    SharingDetector sharing;
+
+    /* Per-stage breakdown of L1 miss latency (MISS_LATENCY_PROFILE) */
+    LatencyProfiler latency;
+
+    /* Per-epoch time series (shell "epoch") */
+    EpochSampler epochs;
+
     /* Ticks the entire system (all cores) */
     void cycle();
 
+    /* Interval model: when every running core is sleeping on charged cycles
+     * and the L2s and DRAM are idle, ticks the clocks through up to limit
+     * base cycles at once and returns how many were skipped */
+    uint64_t skip_idle(uint64_t limit);
+    uint64_t stat_skipped_cycles;
+
+    /* L2 serving a core */
+    L2Cache* l2_of(int core_id) { return l2s[L2_PRIVATE ? core_id : 0]; }
+
+    /* Region of interest (syscalls 0x40/0x41). Globally, the ROI runs from
+     * the first begin to the matching last end; with ROI_PER_CORE each core
+     * brackets its own. Cycles and retired instructions inside are
+     * snapshotted, and with ROI_FAST_FORWARD cores run functionally outside. */
+    int roi_depth;
+    uint64_t roi_begin_cycle, roi_begin_retire;
+    uint64_t stat_roi_cycles, stat_roi_retire, stat_roi_regions;
+    void roi_begin(Core* core);
+    void roi_end(Core* core);
+    bool in_roi(const Core* core) const { return ROI_PER_CORE ? core->roi_active : roi_depth > 0; }
+
+    /* Hardware barrier (syscall 0x50). Arrivals are counted; once the last
+     * participant arrives, all waiting cores resume BARRIER_LATENCY base
+     * cycles later. The participants ($v1 of the first arrival, 0 = all)
+     * are capped at the cores running at each check. */
+    int barrier_arrived;
+    uint32_t barrier_participants;
+    uint64_t stat_barriers;
+    void barrier_arrive(Core* core, uint32_t participants);
+    void barrier_open(); /* Releases the waiting cores once all participants arrived (after arrivals, spawns and halts) */
+
+    /* Breaks every other core's LL link on the block of paddr */
+    void clear_links(uint32_t paddr, const Core* writer);
+
     /* Returns number of cores currently running */
     int active_cores_count();
 };
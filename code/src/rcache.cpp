@@ -0,0 +1,114 @@
+#include "rcache.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+static const uint64_t FNV_PRIME = 0x100000001b3ull;
+
+/* Temporary entry to remove if the process exits without committing */
+static std::string pending_tmp;
+
+static uint64_t fnv(uint64_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+/* Hashes a length prefix and then the bytes, so inputs cannot run together */
+static uint64_t fnv_blob(uint64_t h, const std::string& blob) {
+    uint64_t len = blob.size();
+    h = fnv(h, &len, sizeof(len));
+    return fnv(h, blob.data(), blob.size());
+}
+
+static bool read_file(const char* path, std::string& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    out.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+ResultCache::ResultCache() : saved_stdout(-1) {}
+
+bool ResultCache::make_key(char* const programs[], int num_programs, const std::string& script) {
+    std::string blob;
+    if (!read_file("/proc/self/exe", blob)) return false;
+    uint64_t h = fnv_blob(FNV_OFFSET, blob);
+
+    for (int i = 0; i < num_programs; i++) {
+        if (!read_file(programs[i], blob)) return false;
+        h = fnv_blob(h, blob);
+    }
+    h = fnv_blob(h, script);
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016lx", (unsigned long)h);
+    key = hex;
+    return true;
+}
+
+std::string ResultCache::entry_path() const {
+    return std::string(RESULT_CACHE_DIR) + "/" + key;
+}
+
+bool ResultCache::replay() const {
+    std::string transcript;
+    if (!read_file(entry_path().c_str(), transcript)) return false;
+    fwrite(transcript.data(), 1, transcript.size(), stdout);
+    fflush(stdout);
+    return true;
+}
+
+void ResultCache::abandon() {
+    if (!pending_tmp.empty()) unlink(pending_tmp.c_str());
+}
+
+void ResultCache::record() {
+    if (mkdir(RESULT_CACHE_DIR, 0777) != 0 && errno != EEXIST) return;
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".tmp.%d", (int)getpid());
+    tmp_path = entry_path() + suffix;
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        tmp_path.clear();
+        return;
+    }
+
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    // A run that ends any other way (error exit) leaves no entry behind
+    pending_tmp = tmp_path;
+    atexit(abandon);
+}
+
+void ResultCache::commit() {
+    if (saved_stdout < 0) return;
+
+    fflush(stdout);
+    fsync(STDOUT_FILENO);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    saved_stdout = -1;
+
+    std::string transcript;
+    if (!read_file(tmp_path.c_str(), transcript)) return;
+    fwrite(transcript.data(), 1, transcript.size(), stdout);
+    fflush(stdout);
+
+    if (rename(tmp_path.c_str(), entry_path().c_str()) == 0) pending_tmp.clear();
+}
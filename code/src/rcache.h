@@ -0,0 +1,43 @@
+#ifndef _RCACHE_H_
+#define _RCACHE_H_
+
+#include "config.h"
+#include <cstdint>
+#include <string>
+
+/* Content-addressed store of shell transcripts (RESULT_CACHE).
+ * The key is a 64-bit FNV-1a hash of the simulator executable (code and
+ * every config.h setting), each program file and the command script, in
+ * order and length-prefixed. Entries are files named by the key in
+ * RESULT_CACHE_DIR. A run being recorded has its stdout redirected to a
+ * private temporary file, which commit() prints and then renames onto the
+ * key, so concurrent writers never expose a partial entry and the last
+ * rename of identical content wins. */
+
+class ResultCache {
+public:
+    ResultCache();
+
+    /* Hashes the run; false (no caching) if an input cannot be read */
+    bool make_key(char* const programs[], int num_programs, const std::string& script);
+
+    /* Prints the stored transcript of the key; false on a miss */
+    bool replay() const;
+
+    /* Sends stdout to a temporary entry until commit() */
+    void record();
+
+    /* Restores stdout, prints the transcript and publishes it */
+    void commit();
+
+    std::string key;
+
+private:
+    std::string tmp_path;
+    int saved_stdout;
+
+    std::string entry_path() const;
+    static void abandon();
+};
+
+#endif
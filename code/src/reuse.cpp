@@ -0,0 +1,181 @@
+#include "reuse.h"
+#include <algorithm>
+#include <cstring>
+
+static const uint32_t RD_TREE_INITIAL = 1u << 16;
+
+static int log2_exact(uint64_t v) {
+    int k = 0;
+    while ((1ull << k) < v) k++;
+    return ((1ull << k) == v) ? k : -1;
+}
+
+static int block_shift() {
+    return log2_exact(BLOCK_SIZE);
+}
+
+StackDistance::StackDistance()
+    : accesses(0), fa_cold(0), tree(RD_TREE_INITIAL, 0), now(0),
+      stacks(RD_MAX_SETS_LOG2 + 1), depth(RD_MAX_SETS_LOG2 + 1),
+      sa_hist(RD_MAX_SETS_LOG2 + 1), sa_beyond(RD_MAX_SETS_LOG2 + 1, 0)
+{
+    memset(fa_hist, 0, sizeof(fa_hist));
+    for (int s = 0; s <= RD_MAX_SETS_LOG2; s++) {
+        stacks[s].assign((size_t)RD_MAX_ASSOC << s, 0);
+        depth[s].assign((size_t)1 << s, 0);
+        sa_hist[s].assign(RD_MAX_ASSOC, 0);
+    }
+}
+
+void StackDistance::tree_add(uint32_t t, int v) {
+    for (; t < tree.size(); t += t & (~t + 1)) tree[t] += v;
+}
+
+uint32_t StackDistance::tree_sum(uint32_t t) const {
+    uint32_t sum = 0;
+    for (; t > 0; t -= t & (~t + 1)) sum += tree[t];
+    return sum;
+}
+
+void StackDistance::compact() {
+    // Renumber live times 1 .. L, preserving their order
+    std::vector<std::pair<uint32_t, uint32_t>> live; // (time, block)
+    live.reserve(last.size());
+    for (const auto& kv : last) live.emplace_back(kv.second, kv.first);
+    std::sort(live.begin(), live.end());
+
+    tree.assign(std::max<size_t>(RD_TREE_INITIAL, 2 * live.size() + 2), 0);
+    for (uint32_t i = 0; i < live.size(); i++) {
+        last[live[i].second] = i + 1;
+        tree_add(i + 1, 1);
+    }
+    now = live.size();
+}
+
+void StackDistance::access(uint32_t block) {
+    accesses++;
+
+    // Fully associative
+    if (now + 1 >= tree.size()) compact();
+    now++;
+    auto it = last.find(block);
+    if (it == last.end()) {
+        fa_cold++;
+        last.emplace(block, now);
+    } else {
+        uint32_t prev = it->second;
+        uint32_t d = tree_sum(now - 1) - tree_sum(prev);
+        int bucket = 0;
+        while (d >> bucket) bucket++; // 0 for d == 0, else floor(log2 d) + 1
+        fa_hist[bucket]++;
+        tree_add(prev, -1);
+        it->second = now;
+    }
+    tree_add(now, 1);
+
+    // Set associative
+    for (int s = 0; s <= RD_MAX_SETS_LOG2; s++) {
+        uint32_t set = block & ((1u << s) - 1);
+        uint32_t* stack = &stacks[s][(size_t)set * RD_MAX_ASSOC];
+        int n = depth[s][set];
+        int pos = -1;
+        for (int i = 0; i < n; i++) {
+            if (stack[i] == block) {
+                pos = i;
+                break;
+            }
+        }
+        if (pos >= 0) {
+            sa_hist[s][pos]++;
+        } else {
+            sa_beyond[s]++;
+            if (n < RD_MAX_ASSOC) depth[s][set] = ++n;
+            pos = n - 1;
+        }
+        memmove(stack + 1, stack, pos * sizeof(uint32_t));
+        stack[0] = block;
+    }
+}
+
+uint64_t StackDistance::fa_misses(uint64_t blocks) const {
+    // Distances >= blocks miss; blocks is a power of two, 2^k, i.e. buckets > k
+    int k = log2_exact(blocks);
+    uint64_t misses = fa_cold;
+    for (int b = k + 1; b < 34; b++) misses += fa_hist[b];
+    return misses;
+}
+
+uint64_t StackDistance::sa_misses(int sets_log2, int assoc) const {
+    uint64_t misses = sa_beyond[sets_log2];
+    for (int d = assoc; d < RD_MAX_ASSOC; d++) misses += sa_hist[sets_log2][d];
+    return misses;
+}
+
+ReuseProfiler::ReuseProfiler() {
+    if (RD_PROFILE) {
+        l1d.resize(NUM_CORES + 1);
+        l2.resize(NUM_CORES + 1);
+    }
+}
+
+void ReuseProfiler::access_l1d(int core_id, uint32_t addr) {
+    uint32_t block = addr >> block_shift();
+    l1d[core_id].access(block);
+    l1d[NUM_CORES].access(block);
+}
+
+void ReuseProfiler::access_l2(int core_id, uint32_t addr) {
+    uint32_t block = addr >> block_shift();
+    l2[core_id].access(block);
+    l2[NUM_CORES].access(block);
+}
+
+void ReuseProfiler::write_rows(FILE* f, const char* level, int core, const StackDistance& sd) {
+    char who[16];
+    if (core == NUM_CORES) strcpy(who, "all");
+    else sprintf(who, "%d", core);
+
+    double n = sd.accesses ? (double)sd.accesses : 1.0;
+    for (int s = 0; s <= RD_MAX_SETS_LOG2; s++) {
+        for (int a = 1; a <= RD_MAX_ASSOC; a++) {
+            uint64_t misses = sd.sa_misses(s, a);
+            fprintf(f, "%s,%s,%u,%d,%lu,%lu,%lu,%.6f\n", level, who, 1u << s, a,
+                    ((uint64_t)a << s) * BLOCK_SIZE, sd.accesses, misses, misses / n);
+        }
+    }
+    // Fully associative beyond the set-associative range (sets = 1)
+    for (uint64_t blocks = 2 * RD_MAX_ASSOC; blocks <= (1ull << 24); blocks *= 2) {
+        uint64_t misses = sd.fa_misses(blocks);
+        fprintf(f, "%s,%s,1,%lu,%lu,%lu,%lu,%.6f\n", level, who, blocks, blocks * BLOCK_SIZE,
+                sd.accesses, misses, misses / n);
+    }
+}
+
+bool ReuseProfiler::write_csv(const char* path) const {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "level,core,sets,assoc,size_bytes,accesses,misses,miss_ratio\n");
+    for (int k = 0; k <= NUM_CORES && k < (int)l1d.size(); k++) {
+        if (l1d[k].accesses) write_rows(f, "L1D", k, l1d[k]);
+    }
+    for (int k = 0; k <= NUM_CORES && k < (int)l2.size(); k++) {
+        if (l2[k].accesses) write_rows(f, "L2", k, l2[k]);
+    }
+    fclose(f);
+    return true;
+}
+
+void ReuseProfiler::report() const {
+    const StackDistance& d = l1d[NUM_CORES];
+    const StackDistance& u = l2[NUM_CORES];
+    printf("RDL1DAccesses: %lu\n", d.accesses);
+    int s = log2_exact(L1_D_SETS);
+    if (d.accesses && s >= 0 && s <= RD_MAX_SETS_LOG2 && L1_D_ASSOC <= RD_MAX_ASSOC) {
+        printf("RDL1DMissRatio: %.4f\n", (double)d.sa_misses(s, L1_D_ASSOC) / d.accesses);
+    }
+    printf("RDL2Accesses: %lu\n", u.accesses);
+    s = log2_exact(L2_SETS);
+    if (u.accesses && s >= 0 && s <= RD_MAX_SETS_LOG2 && L2_ASSOC <= RD_MAX_ASSOC) {
+        printf("RDL2MissRatio: %.4f\n", (double)u.sa_misses(s, L2_ASSOC) / u.accesses);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef _REUSE_H_
+#define _REUSE_H_
+
+#include "config.h"
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+/* One-pass LRU stack-distance profiling (Mattson).
+ * Fully associative distances come from a Fenwick tree over access times:
+ * the distance of a re-reference is the number of distinct blocks touched
+ * since its previous access, i.e. the live timestamps after it. Times are
+ * renumbered when the tree fills, so memory grows with distinct blocks, not
+ * accesses. Set-associative distances are kept for 1 .. 2^RD_MAX_SETS_LOG2
+ * sets with a per-set LRU stack truncated at RD_MAX_ASSOC entries.
+ * An A-way cache with S sets misses exactly on the accesses whose distance
+ * within their set is >= A (or that have none), which gives miss-ratio
+ * curves over all sizes and associativities from one pass. */
+
+class StackDistance {
+public:
+    StackDistance();
+
+    void access(uint32_t block);
+
+    uint64_t accesses;
+
+    /* Misses of a fully associative LRU cache of the given number of blocks */
+    uint64_t fa_misses(uint64_t blocks) const;
+
+    /* Misses with 2^sets_log2 sets and assoc ways (assoc <= RD_MAX_ASSOC) */
+    uint64_t sa_misses(int sets_log2, int assoc) const;
+
+private:
+    /* Fully associative: log2 histogram, bucket b > 0 holds [2^(b-1), 2^b) */
+    uint64_t fa_hist[34];
+    uint64_t fa_cold;
+    std::vector<uint32_t> tree; /* Fenwick tree over times 1 .. tree.size() - 1 */
+    uint32_t now;
+    std::unordered_map<uint32_t, uint32_t> last; /* block -> time of last access */
+
+    void tree_add(uint32_t t, int v);
+    uint32_t tree_sum(uint32_t t) const; /* Live times in 1 .. t */
+    void compact();
+
+    /* Set-associative, per sets_log2: stacks of RD_MAX_ASSOC blocks per set */
+    std::vector<std::vector<uint32_t>> stacks;
+    std::vector<std::vector<uint8_t>> depth;
+    std::vector<std::vector<uint64_t>> sa_hist; /* [sets_log2][distance] */
+    std::vector<uint64_t> sa_beyond;            /* Cold or deeper than RD_MAX_ASSOC */
+};
+
+/* Stack-distance profiles of the L1D and L2 demand streams, per core and
+ * aggregate (index NUM_CORES). The L2 stream is the L1 (I and D) misses. */
+class ReuseProfiler {
+public:
+    ReuseProfiler();
+
+    void access_l1d(int core_id, uint32_t addr);
+    void access_l2(int core_id, uint32_t addr);
+
+    /* Writes level,core,sets,assoc,size_bytes,accesses,misses,miss_ratio rows */
+    bool write_csv(const char* path) const;
+
+    /* Prints predicted miss ratios at the configured geometries (rdump) */
+    void report() const;
+
+private:
+    std::vector<StackDistance> l1d, l2;
+
+    static void write_rows(FILE* f, const char* level, int core, const StackDistance& sd);
+};
+
+#endif
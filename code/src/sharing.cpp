@@ -0,0 +1,97 @@
+#include "sharing.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+SharingLine::SharingLine() : events(0) {
+    memset(touched, 0, sizeof(touched));
+    memset(written, 0, sizeof(written));
+    memset(invals, 0, sizeof(invals));
+    memset(downgrades, 0, sizeof(downgrades));
+}
+
+bool SharingLine::false_pair(int a, int b) const {
+    if ((written[a] | written[b]) == 0) return false; // Read sharing
+    return (written[a] & touched[b]) == 0 && (written[b] & touched[a]) == 0;
+}
+
+uint64_t SharingLine::false_events() const {
+    uint64_t n = 0;
+    for (int r = 0; r < NUM_CORES; r++) {
+        for (int h = 0; h < NUM_CORES; h++) {
+            if (false_pair(r, h)) n += invals[r][h] + downgrades[r][h];
+        }
+    }
+    return n;
+}
+
+SharingDetector::SharingDetector() {
+    memset(stat_invals, 0, sizeof(stat_invals));
+    memset(stat_downgrades, 0, sizeof(stat_downgrades));
+}
+
+void SharingDetector::access(int core_id, uint32_t addr, bool is_write) {
+    SharingLine& line = lines[addr & ~(BLOCK_SIZE - 1)];
+    uint32_t word = 1u << ((addr & (BLOCK_SIZE - 1)) >> 2);
+    line.touched[core_id] |= word;
+    if (is_write) line.written[core_id] |= word;
+}
+
+void SharingDetector::coherence(int requester, int holder, uint32_t addr, bool is_write_req) {
+    SharingLine& line = lines[addr & ~(BLOCK_SIZE - 1)];
+    if (is_write_req) {
+        line.invals[requester][holder]++;
+        stat_invals[requester][holder]++;
+    } else {
+        line.downgrades[requester][holder]++;
+        stat_downgrades[requester][holder]++;
+    }
+    line.events++;
+}
+
+static void print_matrix(const char* name, const uint64_t m[NUM_CORES][NUM_CORES]) {
+    for (int r = 0; r < NUM_CORES; r++) {
+        printf("%sCore%d:", name, r);
+        for (int h = 0; h < NUM_CORES; h++) printf(" %lu", m[r][h]);
+        printf("\n");
+    }
+}
+
+void SharingDetector::report() const {
+    // Rows are requesters, columns the cores whose copies they took
+    print_matrix("FSInvalidations", stat_invals);
+    print_matrix("FSDowngrades", stat_downgrades);
+
+    uint64_t events = 0, false_events = 0;
+    std::vector<std::pair<uint64_t, uint32_t>> flagged; // (false events, line)
+    for (const auto& kv : lines) {
+        const SharingLine& line = kv.second;
+        if (line.events == 0) continue;
+        uint64_t f = line.false_events();
+        events += line.events;
+        false_events += f;
+        if (line.events >= FALSE_SHARING_MIN_EVENTS && 2 * f > line.events) flagged.emplace_back(f, kv.first);
+    }
+    printf("FSCoherenceEvents: %lu\n", events);
+    printf("FSFalseSharingEvents: %lu\n", false_events);
+    printf("FSFalseSharedLines: %zu\n", flagged.size());
+
+    std::sort(flagged.begin(), flagged.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    for (size_t i = 0; i < flagged.size() && i < FALSE_SHARING_REPORT_LINES; i++) {
+        const SharingLine& line = lines.at(flagged[i].second);
+        printf("FSLine %08x: events %lu false %lu words touched/written", flagged[i].second, line.events, flagged[i].first);
+        for (int c = 0; c < NUM_CORES; c++) {
+            if (line.touched[c]) printf(" core%d %02x/%02x", c, line.touched[c], line.written[c]);
+        }
+        for (int r = 0; r < NUM_CORES; r++) {
+            for (int h = 0; h < NUM_CORES; h++) {
+                if (line.invals[r][h] + line.downgrades[r][h] == 0) continue;
+                printf(" %d->%d inv %u dg %u", r, h, line.invals[r][h], line.downgrades[r][h]);
+            }
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef _SHARING_H_
+#define _SHARING_H_
+
+#include "config.h"
+#include <cstdint>
+#include <unordered_map>
+
+/* False-sharing detection (FALSE_SHARING_DETECT).
+ * For every line (physical block address), keeps each core's word footprint,
+ * split into words read or written and words written. The footprint comes
+ * from the data accesses of Pipeline::mem and the interval core. Snoops that
+ * invalidate or downgrade another core's L1 copy are counted per
+ * [requester][holder] pair. At report time, an event between two cores is
+ * false sharing when neither core wrote a word that the other touched: the
+ * line moved, but no data was communicated. Pairs that only read the line
+ * are read sharing, not false sharing. Lines with at least
+ * FALSE_SHARING_MIN_EVENTS events, most of them false, are flagged. */
+
+#define SHARING_WORDS (BLOCK_SIZE / 4)
+static_assert(SHARING_WORDS <= 32, "word footprints are 32-bit masks");
+
+struct SharingLine {
+    uint32_t touched[NUM_CORES]; /* Word masks */
+    uint32_t written[NUM_CORES];
+    uint32_t invals[NUM_CORES][NUM_CORES];     /* [requester][holder] */
+    uint32_t downgrades[NUM_CORES][NUM_CORES];
+    uint64_t events;
+
+    SharingLine();
+
+    /* One core of the pair writes the line, but no word written by either
+     * was touched by the other */
+    bool false_pair(int a, int b) const;
+    uint64_t false_events() const;
+};
+
+class SharingDetector {
+public:
+    SharingDetector();
+
+    /* A data access by core_id to physical address addr */
+    void access(int core_id, uint32_t addr, bool is_write);
+
+    /* requester's snoop took holder's copy of addr: invalidated on a
+     * write request, else downgraded to SHARED */
+    void coherence(int requester, int holder, uint32_t addr, bool is_write_req);
+
+    /* Prints core-pair matrices and the flagged lines (rdump) */
+    void report() const;
+
+    uint64_t stat_invals[NUM_CORES][NUM_CORES];
+    uint64_t stat_downgrades[NUM_CORES][NUM_CORES];
+
+private:
+    std::unordered_map<uint32_t, SharingLine> lines;
+};
+
+#endif
@@ -15,6 +15,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdint>
+#include <cctype>
 #include <vector>
 #include <memory>
 
@@ -22,85 +23,31 @@
 #include "pipe.h"
 #include "processor.h"
 #include "config.h"
-
-/***************************************************************/
-/* Statistics.                                                 */
-/***************************************************************/
-
-uint32_t stat_cycles = 0, stat_inst_retire = 0, stat_inst_fetch = 0;
-uint32_t stat_squash = 0;
-
-/***************************************************************/
-/* Main memory.                                                */
-/***************************************************************/
-
-#define MEM_DATA_START  0x10000000
-#define MEM_DATA_SIZE   0x00100000
-#define MEM_TEXT_START  0x00400000
-#define MEM_TEXT_SIZE   0x00100000
-#define MEM_STACK_START 0x7ff00000
-#define MEM_STACK_SIZE  0x00100000
-#define MEM_KDATA_START 0x90000000
-#define MEM_KDATA_SIZE  0x00100000
-#define MEM_KTEXT_START 0x80000000
-#define MEM_KTEXT_SIZE  0x00100000
-
-struct mem_region_t {
-    uint32_t start, size;
-    std::vector<uint8_t> mem;
-    
-    mem_region_t(uint32_t s, uint32_t sz) : start(s), size(sz), mem(sz, 0) {}
-};
-
-/* memory will be dynamically allocated at initialization */
-std::vector<mem_region_t> MEM_REGIONS;
-
-std::unique_ptr<Processor> P;
-
-/***************************************************************/
-/*                                                             */
-/* Procedure: mem_read_32                                      */
-/*                                                             */
-/* Purpose: Read a 32-bit word from memory                     */
-/*                                                             */
-/***************************************************************/
-uint32_t mem_read_32(uint32_t address)
-{
-    for (auto& region : MEM_REGIONS) {
-        if (address >= region.start && address < (region.start + region.size)) {
-            uint32_t offset = address - region.start;
-
-            return
-                (region.mem[offset+3] << 24) |
-                (region.mem[offset+2] << 16) |
-                (region.mem[offset+1] <<  8) |
-                (region.mem[offset+0] <<  0);
-        }
-    }
-
-    return 0;
-}
-
-/***************************************************************/
-/*                                                             */
-/* Procedure: mem_write_32                                     */
-/*                                                             */
-/* Purpose: Write a 32-bit word to memory                      */
-/*                                                             */
-/***************************************************************/
-void mem_write_32(uint32_t address, uint32_t value)
-{
-    for (auto& region : MEM_REGIONS) {
-        if (address >= region.start && address < (region.start + region.size)) {
-            uint32_t offset = address - region.start;
-
-            region.mem[offset+3] = (value >> 24) & 0xFF;
-            region.mem[offset+2] = (value >> 16) & 0xFF;
-            region.mem[offset+1] = (value >>  8) & 0xFF;
-            region.mem[offset+0] = (value >>  0) & 0xFF;
-            return;
-        }
-    }
+#include "energy.h"
+#include "mipssim.h"
+#include "rcache.h"
+#include "console.h"
+#include "observer.h"
+#include <string>
+#include <unistd.h>
+
+/* The simulator this shell drives, and its model for the detailed dump */
+static mipssim_t* sim;
+static Processor* P;
+
+/* Command source: stdin, or the buffered script of a cached run */
+static FILE* cmd_in = stdin;
+static ResultCache results;
+
+/* Leaves the shell: drains the console and closes an open epoch series
+ * (writing its partial last epoch), then publishes a recorded run */
+[[noreturn]] static void shell_exit() {
+  if (sim)
+    mipssim_destroy(sim);
+  console.flush();
+  if (RESULT_CACHE)
+    results.commit();
+  exit(0);
 }
 
 /***************************************************************/
@@ -116,25 +63,17 @@ void help() {
   printf("run n                 -  execute program for n cycles    \n");
   printf("mdump low high        -  dump memory from low to high    \n");
   printf("rdump                 -  dump the register & bus values  \n");
+  printf("mrc file              -  write miss-ratio curves (CSV)   \n");
+  printf("plugin file.so        -  load an observer plugin         \n");
+  printf("epoch n file          -  stats every n cycles (0 = stop) \n");
   printf("input reg_num reg_val -  set GPR reg_num to reg_val      \n");
   printf("high value            -  set the HI register to value    \n");
   printf("low value             -  set the LO register to value    \n");
+  printf("freq domain mhz       -  set clock of coreN/uncore/dram  \n");
   printf("?                     -  display this help menu          \n");
   printf("quit                  -  exit the program                \n\n");
 }
 
-/***************************************************************/
-/*                                                             */
-/* Procedure : cycle                                           */
-/*                                                             */
-/* Purpose   : Execute a cycle                                 */
-/*                                                             */
-/***************************************************************/
-void cycle() {                                                  
-  P->cycle();
-  stat_cycles++;
-}
-
 /***************************************************************/
 /*                                                             */
 /* Procedure : run                                             */
@@ -143,19 +82,14 @@ void cycle() {
 /*                                                             */
 /***************************************************************/
 void run(int num_cycles) {                                      
-  if (P->active_cores_count() == 0) {
+  if (mipssim_halted(sim)) {
     // printf("Can't simulate, Simulator is halted\n\n");
     return;
   }
 
   printf("Simulating for %d cycles...\n\n", num_cycles);
-  for (int i = 0; i < num_cycles; i++) {
-    if (P->active_cores_count() == 0) {
-	    printf("Simulator halted\n\n");
-	    break;
-    }
-    cycle();
-  }
+  if (num_cycles > 0 && mipssim_run(sim, num_cycles) < (uint64_t)num_cycles)
+    printf("Simulator halted\n\n");
 }
 
 /***************************************************************/
@@ -166,17 +100,71 @@ void run(int num_cycles) {
 /*                                                             */
 /***************************************************************/
 void go() {                                                     
-  if (P->active_cores_count() == 0) {
+  if (mipssim_halted(sim)) {
     // printf("Can't simulate, Simulator is halted\n\n");
     return;
   }
 
   printf("Simulating...\n\n");
-  while (P->active_cores_count() > 0)
-    cycle();
+  mipssim_run_until_halt(sim, 0);
   printf("Simulator halted\n\n");
 }
 
+/***************************************************************/
+/*                                                             */
+/* Procedure : set_freq                                        */
+/*                                                             */
+/* Purpose   : DVFS, change the frequency of a clock domain    */
+/*                                                             */
+/***************************************************************/
+void set_freq(const char *domain, int mhz) {
+  ClockDomain *clk = NULL;
+  int core_id;
+
+  bool uncore = strcmp(domain, "uncore") == 0;
+
+  if (uncore)
+    clk = &P->l2s[0]->clock;
+  else if (strcmp(domain, "dram") == 0)
+    clk = &P->dram.clock;
+  else if (sscanf(domain, "core%d", &core_id) == 1 && core_id >= 0 && core_id < NUM_CORES)
+    clk = &P->cores[core_id]->clock;
+
+  if (clk == NULL || mhz <= 0) {
+    printf("Invalid clock domain\n");
+    return;
+  }
+
+  clk->set_freq(mhz);
+  /* Private L2s share one uncore domain setting */
+  for (size_t i = 1; uncore && i < P->l2s.size(); i++)
+    P->l2s[i]->clock.set_freq(mhz);
+  printf("%s: %u MHz, %u mV\n\n", domain, clk->freq_mhz, clk->voltage_mv);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : print_clocks                                    */
+/*                                                             */
+/* Purpose   : Dump clock domain frequencies and local cycles  */
+/*                                                             */
+/***************************************************************/
+void print_clocks() {
+  const ClockDomain& uncore = P->l2s[0]->clock;
+  bool scaled = uncore.freq_mhz != CLOCK_FREQ_MHZ || P->dram.clock.freq_mhz != CLOCK_FREQ_MHZ;
+  for (int k = 0; k < NUM_CORES; k++)
+    scaled |= P->cores[k]->clock.freq_mhz != CLOCK_FREQ_MHZ;
+  if (!scaled && !ENERGY_MODEL)
+    return;
+
+  for (int k = 0; k < NUM_CORES; k++) {
+    const ClockDomain& c = P->cores[k]->clock;
+    printf("Core%dClock: %u MHz %u mV %lu cycles\n", k, c.freq_mhz, c.voltage_mv, c.cycles);
+  }
+  printf("UncoreClock: %u MHz %u mV %lu cycles\n", uncore.freq_mhz, uncore.voltage_mv, uncore.cycles);
+  printf("DRAMClock: %u MHz %u mV %lu cycles\n", P->dram.clock.freq_mhz, P->dram.clock.voltage_mv, P->dram.clock.cycles);
+}
+
 /***************************************************************/ 
 /*                                                             */
 /* Procedure : rdump                                           */
@@ -203,6 +191,193 @@ void rdump() {
     printf("IPC: %0.3f\n", ipc);
     printf("Flushes: %u\n", stat_squash);
 
+    print_clocks();
+
+    if (FST_ENABLE) {
+        printf("FSTUnfairness: %.3f\n", P->fst.unfairness);
+        printf("FSTThrottleDowns: %lu\n", P->fst.stat_throttle_downs);
+        for (int k = 0; k < NUM_CORES; k++) {
+            printf("FSTCore%d: rate %d%% slowdown %.3f\n", k, P->fst.rate(k), P->fst.slowdown[k]);
+        }
+    }
+
+    if (INTERVAL_CORE) {
+        uint64_t branch = 0, dep = 0, mem = 0;
+        for (auto& c : P->cores) {
+            branch += c->stat_interval_branch_cycles;
+            dep += c->stat_interval_dep_cycles;
+            mem += c->stat_stall_cycles;
+        }
+        printf("IntervalBranchCycles: %lu\n", branch);
+        printf("IntervalDependenceCycles: %lu\n", dep);
+        printf("IntervalMemoryStallCycles: %lu\n", mem);
+        printf("IntervalSkippedCycles: %lu\n", P->stat_skipped_cycles);
+    }
+
+    if (L2_MSHR_TARGETS > 1) {
+        uint64_t merges = 0;
+        for (auto* l2 : P->l2s) merges += l2->stat_mshr_merges;
+        printf("L2MSHRMerges: %lu\n", merges);
+    }
+
+    if (L2_PRIVATE) {
+        uint64_t remote = 0;
+        for (auto* l2 : P->l2s) remote += l2->stat_remote_hits;
+        printf("L2RemoteHits: %lu\n", remote);
+    }
+
+    for (size_t k = 0; k < P->l2s.size(); k++) {
+        const L2Cache& l2 = *P->l2s[k];
+        if (l2.incl_policy != INCL_FLEX) break;
+        const char* prefix = L2_PRIVATE ? "L2_" : "";
+        char id[16] = "";
+        if (L2_PRIVATE) sprintf(id, "%zu", k);
+        printf("%s%sFLEXFollowers: %s\n", prefix, id, l2.flex_mode == INCL_EXCLUSIVE ? "exclusive" : "inclusive");
+        printf("%s%sFLEXPSEL: %u\n", prefix, id, l2.flex_psel);
+        printf("%s%sFLEXSwitches: %lu\n", prefix, id, l2.stat_flex_switches);
+    }
+
+    if (TLA_POLICY != TLA_NONE || INCL_STATS) {
+        uint64_t back_invals = 0, hints = 0, eci_invals = 0, qbs_skips = 0;
+        for (auto* l2 : P->l2s) {
+            back_invals += l2->stat_back_invals;
+            hints += l2->stat_tlh_hints;
+            eci_invals += l2->stat_eci_invals;
+            qbs_skips += l2->stat_qbs_skips;
+        }
+        uint64_t harmful = 0, eci_reref = 0;
+        for (int k = 0; k < NUM_CORES; k++) {
+            harmful += P->cores[k]->icache.stat_harmful_back_invals + P->cores[k]->dcache.stat_harmful_back_invals;
+            eci_reref += P->cores[k]->icache.stat_eci_rereferences + P->cores[k]->dcache.stat_eci_rereferences;
+        }
+        printf("BackInvalidations: %lu\n", back_invals);
+        printf("HarmfulBackInvalidations: %lu\n", harmful);
+        if (TLA_POLICY == TLA_TLH) printf("TLAHints: %lu\n", hints);
+        if (TLA_POLICY == TLA_ECI) {
+            printf("TLAEarlyInvalidations: %lu\n", eci_invals);
+            printf("TLAEarlyRereferences: %lu\n", eci_reref);
+        }
+        if (TLA_POLICY == TLA_QBS) printf("TLAQuerySkips: %lu\n", qbs_skips);
+    }
+
+    if (L2_SET_SAMPLING > 1 && !L2_PRIVATE) {
+        const L2Cache& l2 = *P->l2s[0];
+        uint32_t sampled = 0;
+        for (uint32_t i = 0; i < l2.num_sets; i++) sampled += l2.modelled(i);
+        printf("L2SampledSets: %u of %u\n", sampled, l2.num_sets);
+        printf("L2SampledMissRate: %.4f\n", l2.stat_sampled_accesses ? (double)l2.stat_sampled_misses / l2.stat_sampled_accesses : 0.0);
+        printf("L2EstimatedAccesses: %lu\n", l2.stat_estimated_accesses);
+        printf("L2EstimatedMisses: %lu\n", l2.stat_estimated_misses);
+    }
+
+    if (SHADOW_L2_ENABLE) {
+        uint64_t accesses = 0, misses = 0, writebacks = 0;
+        for (auto* l2 : P->l2s) {
+            accesses += l2->shadows[0].stat_accesses;
+            for (int k = 0; k < NUM_CORES; k++) misses += l2->stat_misses[k];
+            writebacks += l2->stat_writebacks;
+        }
+        printf("L2Real: %ux%u %s accesses %lu misses %lu (%.4f) writebacks %lu\n", P->l2s[0]->num_sets,
+               P->l2s[0]->ways, repl_policy_name(P->l2s[0]->repl_policy), accesses, misses,
+               accesses ? (double)misses / accesses : 0.0, writebacks);
+        for (size_t i = 0; i < P->l2s[0]->shadows.size(); i++) {
+            const ShadowCache& s = P->l2s[0]->shadows[i];
+            accesses = misses = writebacks = 0;
+            for (auto* l2 : P->l2s) {
+                accesses += l2->shadows[i].stat_accesses;
+                misses += l2->shadows[i].stat_misses;
+                writebacks += l2->shadows[i].stat_writebacks;
+            }
+            printf("L2Shadow%zu: %ux%u %s accesses %lu misses %lu (%.4f) writebacks %lu\n", i, s.num_sets, s.ways,
+                   repl_policy_name(s.repl_policy), accesses, misses, accesses ? (double)misses / accesses : 0.0, writebacks);
+        }
+    }
+
+    if (DBP_ENABLE) {
+        uint64_t dead_victims = 0, bypasses = 0, false_dead = 0, sampler_hits = 0, sampler_evictions = 0;
+        for (auto* l2 : P->l2s) {
+            dead_victims += l2->dbp.stat_dead_victims;
+            bypasses += l2->dbp.stat_bypasses;
+            false_dead += l2->dbp.stat_false_dead;
+            sampler_hits += l2->dbp.stat_sampler_hits;
+            sampler_evictions += l2->dbp.stat_sampler_evictions;
+        }
+        printf("DBPDeadVictims: %lu\n", dead_victims);
+        printf("DBPBypasses: %lu\n", bypasses);
+        printf("DBPFalseDead: %lu\n", false_dead);
+        printf("DBPSamplerHits: %lu\n", sampler_hits);
+        printf("DBPSamplerEvictions: %lu\n", sampler_evictions);
+    }
+
+    if (P->stat_roi_regions > 0 || ROI_FAST_FORWARD) {
+        printf("ROIRegions: %lu\n", P->stat_roi_regions);
+        if (!ROI_PER_CORE) {
+            printf("ROICycles: %lu\n", P->stat_roi_cycles);
+            printf("ROIRetiredInstr: %lu\n", P->stat_roi_retire);
+            printf("ROIIPC: %0.3f\n", P->stat_roi_cycles ? (double)P->stat_roi_retire / P->stat_roi_cycles : 0.0);
+        } else {
+            for (int k = 0; k < NUM_CORES; k++) {
+                const Core& c = *P->cores[k];
+                if (c.stat_roi_cycles == 0) continue;
+                printf("ROICore%d: cycles %lu retired %lu IPC %0.3f\n", k, c.stat_roi_cycles, c.stat_roi_retire,
+                       (double)c.stat_roi_retire / c.stat_roi_cycles);
+            }
+        }
+        uint64_t functional = 0;
+        for (auto& c : P->cores) functional += c->stat_inst_functional;
+        printf("FunctionalInstr: %lu\n", functional);
+    }
+
+    if (SMARTS_ENABLE) {
+        P->smarts.report();
+    }
+
+    if (RD_PROFILE) {
+        P->reuse.report();
+    }
+
+    if (FALSE_SHARING_DETECT) {
+        P->sharing.report();
+    }
+
+    if (MISS_LATENCY_PROFILE) {
+        P->latency.report();
+    }
+
+    if (DBT_ENABLE) {
+        printf("DBTBlocks: %lu\n", P->dbt.stat_blocks);
+        printf("DBTBlockExecs: %lu\n", P->dbt.stat_block_execs);
+        printf("DBTTranslatedInstr: %lu\n", P->dbt.stat_insts);
+        printf("DBTChained: %lu\n", P->dbt.stat_chained);
+        printf("DBTInvalidations: %lu\n", P->dbt.stat_invalidations);
+    }
+
+    uint64_t sc_success = 0, sc_fail = 0, barrier_cycles = 0;
+    for (auto& c : P->cores) {
+        sc_success += c->stat_sc_success;
+        sc_fail += c->stat_sc_fail;
+        barrier_cycles += c->stat_barrier_cycles;
+    }
+    if (sc_success + sc_fail > 0) {
+        printf("SCSuccesses: %lu\n", sc_success);
+        printf("SCFailures: %lu\n", sc_fail);
+    }
+    if (P->stat_barriers > 0) {
+        printf("Barriers: %lu\n", P->stat_barriers);
+        printf("BarrierWaitCycles: %lu\n", barrier_cycles);
+    }
+
+    if (ENERGY_MODEL) {
+        energy_report(*P, stat_cycles);
+    }
+
+    if (P->page_alloc.policy != PAGE_ALLOC_IDENTITY) {
+        printf("PagesMapped: %lu\n", P->page_alloc.stat_pages_mapped);
+        for (uint32_t c = 0; c < P->page_alloc.num_colors(); c++) {
+            printf("PageColor%u: %lu\n", c, P->page_alloc.stat_pages_per_color[c]);
+        }
+    }
+
     for (int k = 1; k < NUM_CORES; k++) {
         printf("CPU %d:\n", k);
         auto& pipe_k = *(P->cores[k]->pipe);
@@ -229,7 +404,7 @@ void mdump(int start, int stop) {
   printf("\nMemory content [0x%08x..0x%08x] :\n", start, stop);
   printf("-------------------------------------\n");
   for (address = start; address <= stop; address += 4)
-    printf("  0x%08x (%d) : 0x%08x\n", address, address, mem_read_32(address));
+    printf("  0x%08x (%d) : 0x%08x\n", address, address, mipssim_read_word(sim, address));
   printf("\n");
 }
 
@@ -242,13 +417,13 @@ void mdump(int start, int stop) {
 /***************************************************************/
 void get_command() {
   char buffer[20];
-  int start, stop, cycles;
+  int start, stop, cycles, mhz;
   int register_no, register_value;
 
   printf("MIPS-SIM> ");
 
-  if (scanf("%s", buffer) == EOF)
-      exit(0);
+  if (fscanf(cmd_in, "%s", buffer) == EOF)
+      shell_exit();
 
   printf("\n");
 
@@ -260,53 +435,97 @@ void get_command() {
 
   case 'M':
   case 'm':
-    if (scanf("%i %i", &start, &stop) != 2)
+    if (buffer[1] == 'r' || buffer[1] == 'R') {
+        char path[256];
+        if (fscanf(cmd_in, "%255s", path) != 1)
+            break;
+        if (!RD_PROFILE)
+            printf("mrc: build with RD_PROFILE 1\n");
+        else if (!P->reuse.write_csv(path))
+            printf("mrc: cannot write %s\n", path);
+        break;
+    }
+    if (fscanf(cmd_in, "%i %i", &start, &stop) != 2)
         break;
 
     mdump(start, stop);
     break;
 
+  case 'P':
+  case 'p':
+    {
+        char path[256];
+        if (fscanf(cmd_in, "%255s", path) != 1)
+            break;
+        if (!OBSERVER_ENABLE)
+            printf("plugin: build with OBSERVER_ENABLE 1\n");
+        else
+            mipssim_load_plugin(sim, path);
+    }
+    break;
+
   case '?':
     help();
     break;
   case 'Q':
   case 'q':
     printf("Bye.\n");
-    exit(0);
+    shell_exit();
 
   case 'R':
   case 'r':
     if (buffer[1] == 'd' || buffer[1] == 'D')
         rdump();
     else {
-	    if (scanf("%d", &cycles) != 1) break;
+	    if (fscanf(cmd_in, "%d", &cycles) != 1) break;
 	    run(cycles);
     }
     break;
 
+  case 'E':
+  case 'e':
+    {
+        char path[256] = "";
+        if (fscanf(cmd_in, "%i", &cycles) != 1)
+            break;
+        if (cycles > 0 && fscanf(cmd_in, "%255s", path) != 1)
+            break;
+        if (mipssim_set_epoch(sim, cycles > 0 ? cycles : 0, path) != 0)
+            printf("epoch: cannot write %s\n", path);
+    }
+    break;
+
+  case 'F':
+  case 'f':
+    if (fscanf(cmd_in, "%19s %i", buffer, &mhz) != 2)
+      break;
+
+    set_freq(buffer, mhz);
+    break;
+
   case 'I':
   case 'i':
-   if (scanf("%i %i", &register_no, &register_value) != 2)
+   if (fscanf(cmd_in, "%i %i", &register_no, &register_value) != 2)
       break;
    
    // printf("%i %i\n", register_no, register_value);
-   P->cores[0]->pipe->REGS[register_no] = register_value;
+   mipssim_set_reg(sim, 0, register_no, register_value);
    break;
    
   case 'H':
   case 'h':
-   if (scanf("%i", &register_value) != 1)
+   if (fscanf(cmd_in, "%i", &register_value) != 1)
       break;
 
-   P->cores[0]->pipe->HI = register_value; 
+   mipssim_set_reg(sim, 0, MIPSSIM_REG_HI, register_value);
    break;
   
   case 'L':
   case 'l':
-   if (scanf("%i", &register_value) != 1)
+   if (fscanf(cmd_in, "%i", &register_value) != 1)
       break;
 
-   P->cores[0]->pipe->LO = register_value; 
+   mipssim_set_reg(sim, 0, MIPSSIM_REG_LO, register_value);
    break;
 
   default:
@@ -315,51 +534,6 @@ void get_command() {
   }
 }
 
-/***************************************************************/
-/*                                                             */
-/* Procedure : init_memory                                     */
-/*                                                             */
-/* Purpose   : Allocate and zero memoryy                       */
-/*                                                             */
-/***************************************************************/
-void init_memory() {                                           
-    MEM_REGIONS.clear();
-    MEM_REGIONS.emplace_back(MEM_TEXT_START, MEM_TEXT_SIZE);
-    MEM_REGIONS.emplace_back(MEM_DATA_START, MEM_DATA_SIZE);
-    MEM_REGIONS.emplace_back(MEM_STACK_START, MEM_STACK_SIZE);
-    MEM_REGIONS.emplace_back(MEM_KDATA_START, MEM_KDATA_SIZE);
-    MEM_REGIONS.emplace_back(MEM_KTEXT_START, MEM_KTEXT_SIZE);
-}
-
-/**************************************************************/
-/*                                                            */
-/* Procedure : load_program                                   */
-/*                                                            */
-/* Purpose   : Load program and service routines into mem.    */
-/*                                                            */
-/**************************************************************/
-void load_program(char *program_filename) {                   
-  FILE * prog;
-  int ii, word;
-
-  /* Open program file. */
-  prog = fopen(program_filename, "r");
-  if (prog == NULL) {
-    printf("Error: Can't open program file %s\n", program_filename);
-    exit(-1);
-  }
-
-  /* Read in the program. */
-
-  ii = 0;
-  while (fscanf(prog, "%x\n", &word) != EOF) {
-    mem_write_32(MEM_TEXT_START + ii, word);
-    ii += 4;
-  }
-
-  printf("Read %d words from program into memory.\n\n", ii/4);
-}
-
 /************************************************************/
 /*                                                          */
 /* Procedure : initialize                                   */
@@ -368,13 +542,33 @@ void load_program(char *program_filename) {
 /*             and set up initial state of the machine.     */
 /*                                                          */
 /************************************************************/
-void initialize(char *program_filename, int num_prog_files) { 
-  init_memory();
-  P = std::make_unique<Processor>();
+void initialize(char *program_files[], int num_prog_files) { 
+  sim = mipssim_create();
+  P = mipssim_processor(sim);
   for (int i = 0; i < num_prog_files; i++) {
-    load_program(program_filename);
-    while(*program_filename++ != '\0');
+    int words = mipssim_load_program(sim, program_files[i]);
+    if (words < 0) {
+      printf("Error: Can't open program file %s\n", program_files[i]);
+      exit(-1);
+    }
+    printf("Read %d words from program into memory.\n\n", words);
+  }
+}
+
+/* Only stdout is cached, so a run whose result depends on more than the
+ * hashed inputs cannot be replayed: plugin loads a .so by path, mrc and
+ * epoch write side files. Commands match on their leading letters as in
+ * get_command; an argument that looks like one only costs a cache miss. */
+static bool cacheable(const std::string& script) {
+  size_t i = 0;
+  while ((i = script.find_first_not_of(" \t\r\n", i)) != std::string::npos) {
+    char c = tolower(script[i]);
+    char d = i + 1 < script.size() ? tolower(script[i + 1]) : 0;
+    if (c == 'p' || c == 'e' || (c == 'm' && d == 'r'))
+      return false;
+    i = script.find_first_of(" \t\r\n", i);
   }
+  return true;
 }
 
 /***************************************************************/
@@ -392,9 +586,25 @@ int main(int argc, char *argv[]) {
     exit(1);
   }
 
+  /* A piped script is read whole so the run can be looked up by content */
+  static std::string script;
+  if (RESULT_CACHE && !isatty(STDIN_FILENO)) {
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0)
+      script.append(buf, n);
+    if (cacheable(script) && results.make_key(argv + 1, argc - 1, script)) {
+      if (results.replay())
+        return 0;
+      results.record();
+    }
+    script += "\n"; /* fmemopen rejects an empty buffer */
+    cmd_in = fmemopen(&script[0], script.size(), "r");
+  }
+
   printf("MIPS Simulator\n\n");
 
-  initialize(argv[1], argc - 1);
+  initialize(argv + 1, argc - 1);
 
   while (1)
     get_command();
@@ -0,0 +1,120 @@
+#include "smarts.h"
+#include "processor.h"
+#include "console.h"
+#include <cmath>
+#include <cstdio>
+
+void SampleStat::add(double x, double w) {
+    n++;
+    w_sum += w;
+    w2_sum += w * w;
+    double delta = x - mean;
+    mean += delta * w / w_sum;
+    m2 += w * delta * (x - mean);
+}
+
+double SampleStat::half_width(double z) const {
+    return n > 1 ? z * std::sqrt(variance() / effective_n()) : 0.0;
+}
+
+SmartsSampler::SmartsSampler(Processor* p)
+    : proc(p), phase(SMARTS_WARMING), period(SMARTS_PERIOD),
+      unit_cycles(0), unit_insts(0), unit_l1d_misses(0), unit_l2_misses(0)
+{
+    phase_end = SMARTS_PERIOD - SMARTS_WARMUP - SMARTS_UNIT;
+}
+
+uint64_t SmartsSampler::instructions() const {
+    uint64_t total = 0;
+    for (auto& c : proc->cores) total += c->stat_inst_functional + c->stat_inst_retire;
+    return total;
+}
+
+uint64_t SmartsSampler::l1d_misses() const {
+    uint64_t total = 0;
+    for (auto& c : proc->cores) total += c->dcache.stat_misses;
+    return total;
+}
+
+uint64_t SmartsSampler::l2_misses() const {
+    uint64_t total = 0;
+    for (auto* l2 : proc->l2s) {
+        for (int k = 0; k < NUM_CORES; k++) total += l2->stat_misses[k];
+    }
+    return total;
+}
+
+void SmartsSampler::set_detailed(bool on) {
+    for (auto& c : proc->cores) c->set_functional(!on);
+}
+
+double SmartsSampler::rel_error() const {
+    return cpi.mean > 0 ? cpi.half_width(SMARTS_Z) / cpi.mean : 0.0;
+}
+
+uint64_t SmartsSampler::recommended_samples() const {
+    if (cpi.n < 2 || cpi.mean <= 0) return SMARTS_MIN_SAMPLES;
+    double cv = std::sqrt(cpi.variance()) / cpi.mean;
+    double n = SMARTS_Z * cv / SMARTS_TARGET_ERROR;
+    // Effective samples are fewer than units when the weights differ
+    return (uint64_t)std::ceil(n * n * cpi.n / cpi.effective_n());
+}
+
+void SmartsSampler::cycle() {
+    uint64_t insts = instructions();
+    if (insts < phase_end) return;
+
+    switch (phase) {
+        case SMARTS_WARMING:
+            set_detailed(true);
+            phase = SMARTS_DETAILED;
+            phase_end = insts + SMARTS_WARMUP;
+            break;
+
+        case SMARTS_DETAILED:
+            unit_cycles = stat_cycles;
+            unit_insts = insts;
+            unit_l1d_misses = l1d_misses();
+            unit_l2_misses = l2_misses();
+            phase = SMARTS_MEASURE;
+            phase_end = insts + SMARTS_UNIT;
+            break;
+
+        case SMARTS_MEASURE: {
+            double n = (double)(insts - unit_insts);
+            double w = (double)period;
+            cpi.add((stat_cycles - unit_cycles) / n, w);
+            l1d_mpki.add((l1d_misses() - unit_l1d_misses) * 1000.0 / n, w);
+            l2_mpki.add((l2_misses() - unit_l2_misses) * 1000.0 / n, w);
+
+            // Take units more often while the error bound is not met
+            if (cpi.n >= SMARTS_MIN_SAMPLES && rel_error() > SMARTS_TARGET_ERROR) {
+                uint64_t wanted = (uint64_t)SMARTS_PERIOD * cpi.n / recommended_samples();
+                uint64_t min_period = 2 * (SMARTS_WARMUP + SMARTS_UNIT);
+                if (wanted < min_period) wanted = min_period;
+                if (wanted < period) period = wanted;
+            }
+
+#ifdef DEBUG
+            console.print(CONSOLE_SYSTEM, "[SMARTS] Unit %lu: CPI %.3f (mean %.3f +/- %.3f), period %lu\n", cpi.n,
+                   (stat_cycles - unit_cycles) / n, cpi.mean, cpi.half_width(SMARTS_Z), period);
+#endif
+
+            set_detailed(false);
+            phase = SMARTS_WARMING;
+            phase_end = insts + period - SMARTS_WARMUP - SMARTS_UNIT;
+            break;
+        }
+    }
+}
+
+void SmartsSampler::report() const {
+    printf("SMARTSSamples: %lu\n", cpi.n);
+    printf("SMARTSCPI: %.4f +/- %.4f\n", cpi.mean, cpi.half_width(SMARTS_Z));
+    printf("SMARTSL1DMPKI: %.3f +/- %.3f\n", l1d_mpki.mean, l1d_mpki.half_width(SMARTS_Z));
+    printf("SMARTSL2MPKI: %.3f +/- %.3f\n", l2_mpki.mean, l2_mpki.half_width(SMARTS_Z));
+    printf("SMARTSCPIError: %.2f%%\n", rel_error() * 100);
+    printf("SMARTSRecommendedSamples: %lu\n", recommended_samples());
+    printf("SMARTSPeriod: %lu\n", period);
+    printf("SMARTSEstimatedCycles: %.0f\n", cpi.mean * instructions());
+}
@@ -0,0 +1,76 @@
+#ifndef _SMARTS_H_
+#define _SMARTS_H_
+
+#include "config.h"
+#include <cstdint>
+
+/* SMARTS statistical sampling.
+ * Execution alternates between functional warming (cores run functionally
+ * while L1Cache::warm keeps the caches current) and, every period, a detailed
+ * window: SMARTS_WARMUP instructions of detailed warmup followed by a
+ * measured unit of SMARTS_UNIT instructions. Each unit yields one sample of
+ * CPI (base cycles per instruction, all cores) and of L1D and L2 misses per
+ * kilo-instruction. Confidence intervals are z * s / sqrt(n) from the sample
+ * variance. After SMARTS_MIN_SAMPLES units, the period shrinks while the CPI
+ * error is above SMARTS_TARGET_ERROR, to reach the sample count
+ * n = (z * s / (error * mean))^2. Units are weighted by the period they
+ * stand for, so denser sampling late in the run does not bias the means;
+ * n is then the effective sample size. */
+
+class Processor;
+
+/* Running weighted mean and variance (West's update of Welford) */
+struct SampleStat {
+    uint64_t n;
+    double w_sum, w2_sum;
+    double mean, m2;
+
+    SampleStat() : n(0), w_sum(0), w2_sum(0), mean(0), m2(0) {}
+    void add(double x, double w);
+    double variance() const { return n > 1 ? m2 / w_sum * n / (n - 1) : 0.0; }
+    double effective_n() const { return w2_sum > 0 ? w_sum * w_sum / w2_sum : 0.0; }
+    double half_width(double z) const;
+};
+
+enum SmartsPhase {
+    SMARTS_WARMING = 0,   /* Functional warming */
+    SMARTS_DETAILED = 1,  /* Detailed warmup */
+    SMARTS_MEASURE = 2    /* Measured unit */
+};
+
+class SmartsSampler {
+public:
+    SmartsSampler(Processor* p);
+
+    Processor* proc;
+    SmartsPhase phase;
+    uint64_t phase_end; /* Instruction count that ends the phase */
+    uint64_t period;    /* Instructions from one unit to the next */
+
+    /* Counters at the start of the current unit */
+    uint64_t unit_cycles, unit_insts, unit_l1d_misses, unit_l2_misses;
+
+    SampleStat cpi, l1d_mpki, l2_mpki;
+
+    /* Called every base cycle; switches phases on instruction counts */
+    void cycle();
+
+    /* Instructions executed by all cores, functional and detailed */
+    uint64_t instructions() const;
+
+    /* CPI confidence half-width relative to the mean */
+    double rel_error() const;
+
+    /* Units needed to reach SMARTS_TARGET_ERROR at the current variance */
+    uint64_t recommended_samples() const;
+
+    /* Prints the estimates (rdump) */
+    void report() const;
+
+private:
+    void set_detailed(bool on);
+    uint64_t l1d_misses() const;
+    uint64_t l2_misses() const;
+};
+
+#endif
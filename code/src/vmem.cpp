@@ -0,0 +1,148 @@
+#include "vmem.h"
+#include "dram.h"
+#include "console.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+PageAllocator::PageAllocator(const DRAM* dram)
+    : policy((PageAllocPolicy)PAGE_ALLOC_POLICY), dram_ref(dram),
+      stat_pages_mapped(0), seq_cursor(0), rng(PAGE_ALLOC_SEED)
+{
+    page_shift = (uint32_t)std::log2(PAGE_SIZE);
+    num_frames = PHYS_MEM_SIZE / PAGE_SIZE;
+
+    // Bank colours only exist if the bank index lies above the page offset.
+    // Otherwise every page already covers all banks and colouring is a no-op.
+    num_bank_colors = (DRAM_BANK_SHIFT >= page_shift) ? TOTAL_BANKS : 1;
+
+    // L2 colours: number of pages that fit in one L2 way
+    uint32_t way_size = L2_SETS * BLOCK_SIZE;
+    num_l2_colors = (way_size > PAGE_SIZE) ? way_size / PAGE_SIZE : 1;
+
+    if (policy != PAGE_ALLOC_IDENTITY) {
+        frame_used.assign(num_frames, false);
+    }
+    color_cursor.assign(num_colors(), 0);
+    stat_pages_per_color.assign(num_colors(), 0);
+
+    for (int c = 0; c < NUM_CORES; c++) {
+        core_next_color.push_back(c);
+    }
+}
+
+uint32_t PageAllocator::num_colors() const {
+    switch (policy) {
+        case PAGE_ALLOC_BANK_SPREAD:
+        case PAGE_ALLOC_BANK_ISOLATE:
+            return num_bank_colors;
+        case PAGE_ALLOC_L2_COLOR:
+            return num_l2_colors;
+        default:
+            return 1;
+    }
+}
+
+uint32_t PageAllocator::color_of(uint32_t pfn) const {
+    switch (policy) {
+        case PAGE_ALLOC_BANK_SPREAD:
+        case PAGE_ALLOC_BANK_ISOLATE:
+            if (num_bank_colors == 1) return 0;
+            return dram_ref->get_flat_bank_id(pfn << page_shift);
+        case PAGE_ALLOC_L2_COLOR:
+            return pfn % num_l2_colors;
+        default:
+            return 0;
+    }
+}
+
+void PageAllocator::map_region(uint32_t start, uint32_t size, int core_id) {
+    if (policy == PAGE_ALLOC_IDENTITY) return;
+    for (uint32_t addr = start & ~(PAGE_SIZE - 1); addr < start + size; addr += PAGE_SIZE) {
+        translate(addr, core_id);
+    }
+}
+
+uint32_t PageAllocator::pick_color(int core_id) {
+    uint32_t ncol = num_colors();
+    uint32_t core = (core_id < 0) ? 0 : (uint32_t)core_id;
+    uint32_t& next = core_next_color[core % NUM_CORES];
+
+    if (policy == PAGE_ALLOC_BANK_SPREAD) {
+        // Round-robin over every colour, each core starting at its own offset
+        uint32_t color = next % ncol;
+        next = (color + 1) % ncol;
+        return color;
+    }
+
+    // Isolation: core c owns colours {c, c + NUM_CORES, c + 2*NUM_CORES, ...}
+    if (ncol < NUM_CORES) return core % ncol;
+
+    uint32_t owned = (ncol - core + NUM_CORES - 1) / NUM_CORES;
+    uint32_t slot = (next / NUM_CORES) % owned;
+    next = core + NUM_CORES * ((slot + 1) % owned);
+    return core + NUM_CORES * slot;
+}
+
+int PageAllocator::alloc_sequential() {
+    for (uint32_t n = 0; n < num_frames; n++) {
+        uint32_t f = (seq_cursor + n) % num_frames;
+        if (!frame_used[f]) {
+            seq_cursor = f + 1;
+            return f;
+        }
+    }
+    return -1;
+}
+
+int PageAllocator::alloc_random() {
+    uint32_t start = rng() % num_frames;
+    for (uint32_t n = 0; n < num_frames; n++) {
+        uint32_t f = (start + n) % num_frames;
+        if (!frame_used[f]) return f;
+    }
+    return -1;
+}
+
+int PageAllocator::alloc_colored(uint32_t color) {
+    for (uint32_t f = color_cursor[color]; f < num_frames; f++) {
+        if (!frame_used[f] && color_of(f) == color) {
+            color_cursor[color] = f + 1;
+            return f;
+        }
+    }
+    // Colour exhausted: fall back to any free frame
+    return alloc_sequential();
+}
+
+uint32_t PageAllocator::map_page(uint32_t vpn, int core_id) {
+    int pfn = -1;
+    switch (policy) {
+        case PAGE_ALLOC_RANDOM:
+            pfn = alloc_random();
+            break;
+        case PAGE_ALLOC_BANK_SPREAD:
+        case PAGE_ALLOC_BANK_ISOLATE:
+        case PAGE_ALLOC_L2_COLOR:
+            pfn = alloc_colored(pick_color(core_id));
+            break;
+        default:
+            pfn = alloc_sequential();
+            break;
+    }
+
+    if (pfn < 0) {
+        printf("Error: out of physical memory mapping page %08x\n", vpn << page_shift);
+        exit(-1);
+    }
+
+    frame_used[pfn] = true;
+    page_table[vpn] = pfn;
+    stat_pages_mapped++;
+    stat_pages_per_color[color_of(pfn)]++;
+
+#ifdef DEBUG
+    console.print(CONSOLE_SYSTEM, "[VMEM] Core %d: VPN %05x -> PFN %05x (colour %u)\n", core_id, vpn, pfn, color_of(pfn));
+#endif
+    return pfn;
+}
@@ -0,0 +1,72 @@
+#ifndef _VMEM_H_
+#define _VMEM_H_
+
+#include "config.h"
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <random>
+
+/* Virtual-to-physical page mapping for the timing model.
+ * Functional memory (shell.cpp) stays virtually addressed; caches and DRAM
+ * see physical addresses produced here. Frames are allocated on first touch. */
+
+enum PageAllocPolicy {
+    PAGE_ALLOC_IDENTITY = 0,     /* No translation (PA = VA) */
+    PAGE_ALLOC_SEQUENTIAL = 1,   /* First-touch, next free frame */
+    PAGE_ALLOC_RANDOM = 2,       /* First-touch, random free frame */
+    PAGE_ALLOC_BANK_SPREAD = 3,  /* Round-robin a core's pages over all DRAM banks */
+    PAGE_ALLOC_BANK_ISOLATE = 4, /* Give each core its own subset of DRAM banks */
+    PAGE_ALLOC_L2_COLOR = 5      /* Give each core its own subset of L2 set colours */
+};
+
+class DRAM;
+
+class PageAllocator {
+public:
+    PageAllocator(const DRAM* dram);
+
+    PageAllocPolicy policy;
+    const DRAM* dram_ref;
+
+    uint32_t page_shift;
+    uint32_t num_frames;
+    uint32_t num_bank_colors; /* 1 if bank bits lie inside the page offset */
+    uint32_t num_l2_colors;   /* L2 way size / page size */
+
+    /* Statistics */
+    uint64_t stat_pages_mapped;
+    std::vector<uint64_t> stat_pages_per_color;
+
+    /* Translate a virtual address touched by core_id (allocates on first touch) */
+    uint32_t translate(uint32_t vaddr, int core_id) {
+        if (policy == PAGE_ALLOC_IDENTITY) return vaddr;
+        uint32_t vpn = vaddr >> page_shift;
+        auto it = page_table.find(vpn);
+        uint32_t pfn = (it != page_table.end()) ? it->second : map_page(vpn, core_id);
+        return (pfn << page_shift) | (vaddr & (PAGE_SIZE - 1));
+    }
+
+    /* Loader helper: map every page of [start, start+size) on behalf of core_id */
+    void map_region(uint32_t start, uint32_t size, int core_id);
+
+    /* Colour of a physical frame under the active policy */
+    uint32_t color_of(uint32_t pfn) const;
+    uint32_t num_colors() const;
+
+private:
+    std::unordered_map<uint32_t, uint32_t> page_table; /* VPN -> PFN */
+    std::vector<bool> frame_used;
+    uint32_t seq_cursor;
+    std::vector<uint32_t> color_cursor;    /* Per colour: next frame to scan */
+    std::vector<uint32_t> core_next_color; /* Per core: round-robin position */
+    std::mt19937 rng;
+
+    uint32_t map_page(uint32_t vpn, int core_id);
+    uint32_t pick_color(int core_id);
+    int alloc_sequential();
+    int alloc_random();
+    int alloc_colored(uint32_t color);
+};
+
+#endif